@@ -2,88 +2,191 @@
 #define ASSEMBLER_H
 
 #include "IntExprSolver.h"
+#include "Keywords.h"
 
 #include <fstream>
 #include <unordered_map>
-#include <list>
+#include <memory_resource>
 #include <vector>
 #include <cstdlib>
 #include <string>
+#include <string_view>
 
-using std::string, std::vector, std::list;
-using cmd_code_map_t = std::unordered_map<string, string>;
-using name_address_t = std::unordered_map<string, uint16_t>;
+using std::string, std::string_view, std::vector;
 
 namespace assem
 {
+    // Address of a name and its text for the second pass
+    struct NameAddress
+    {
+        uint16_t address = 0;
+        string_view text;
+        bool data = false; // Variable of the data segment, its address is counted from the end of the code
+    };
+
+    using name_address_t = std::pmr::unordered_map<string_view, NameAddress>;
+
+    // Part of the program holding an address (the Jump over variables): the value of the
+    // part is counted from the address, which is moved with the block (see Incremental.cpp)
+    struct LocalAddress
+    {
+        uint32_t part;
+        uint16_t address;
+    };
+
+    // Line of the program: its parts are parts[first], ..., parts[first + count - 1]
+    struct CodeLine
+    {
+        uint32_t first;
+        uint32_t count;
+    };
+
+    // Program being translated. The source file is read into one buffer, the parts
+    // of all lines are views into it (or into the arena for the generated text)
+    // kept in one array, and the lines are ranges of this array. The arrays are
+    // reserved once after counting the parts of the source, so the translation
+    // does not allocate memory for every part and line
+    struct Program
+    {
+        std::pmr::monotonic_buffer_resource arena;
+        string source;
+        std::pmr::vector<string_view> parts{&arena};
+        std::pmr::vector<CodeLine> lines{&arena};
+        name_address_t name_address{&arena}; // Hash table for storing variable addresses
+        std::pmr::vector<LocalAddress> local_addresses{&arena};
+        std::pmr::vector<uint32_t> expressions{&arena}; // Parts with expressions of names, solved after the first pass
+
+        // The variables are gathered into the data segment after the code instead of being
+        // placed among the commands with a Jump over them (set before the translation)
+        bool data_segment = false;
+        std::pmr::vector<CodeLine> data_lines{&arena};
+        uint16_t data_size = 0;
+
+        // Copying generated text into the arena
+        string_view store(string_view text);
+
+        string_view part(const CodeLine& line, uint32_t i) const noexcept { return parts[line.first + i]; }
+    };
+
     // --- Public functions ---
 
-    // Translation of an assembler program into codes
-    bool asm_to_code(const string& source_file_path, const string& target_file_path) noexcept;
+    // Translation of an assembler program into codes (as text or as a binary image)
+    bool asm_to_code(const string& source_file_path, const string& target_file_path, bool image = false) noexcept;
+
+    // Translation of an assembler program into codes kept in memory.
+    // With optimize the peephole optimization removes the useless commands (see Peephole.cpp)
+    bool translate(const string& source_file_path, Program& program, bool optimize = false) noexcept;
+
+    // Writing the translated program to a file (as text or as a binary image)
+    bool write_code(const Program& program, const string& target_file_path, bool image) noexcept;
+
+    // Translation that keeps the translated blocks of the source (procedures, groups of
+    // variables and the code between them) in the cache file and translates again only
+    // the changed ones (see Incremental.cpp). The code is written to the target file
+    // unless its path is empty, program_image gets the binary image of the program
+    bool asm_to_code_incremental(const string& source_file_path, const string& target_file_path, bool image,
+        const string& cache_file_path, string& program_image) noexcept;
+
+    // Path of the object file of a module: the source with the extension .obj
+    string object_file_path(const string& source_file_path);
+
+    // Translation of a module into an object file: the relocatable records of its blocks
+    // with the names it defines and the fixups of the names it uses (see Linker.cpp)
+    bool assemble_object(const string& source_file_path, const string& object_file_path) noexcept;
+
+    // Linking modules (sources or object files) into one program in the order of the list.
+    // The sources whose object files are missing or older are translated first, in parallel.
+    // The code is written to the target file unless its path is empty, program_image gets
+    // the binary image of the program
+    bool link_modules(const vector<string>& module_file_paths, const string& target_file_path, bool image,
+        string& program_image) noexcept;
 
-    // Starting the program
-    int run(const string& vm_path, const string& target_file_path);
+    // Starting the program in the virtual machine of this process.
+    // Its image is loaded straight into the memory of a processor
+    int run(const Program& program);
+
+    // Starting a program encoded as a binary image in the virtual machine of this process
+    int run_image(const string& image);
+
+    // Printing the execution trace written by the virtual machine (see TraceDecoder.cpp)
+    bool print_trace(const string& trace_file_path, std::ostream& out) noexcept;
 
     // --- Private functions ---
     namespace priv
     {
-        // Hash table for storing variable addresses
-        static name_address_t name_address;
-
-        // Hash table for commands and their codes
-        static const cmd_code_map_t command_code = {
-            { "end", "0" },   { "jmp", "1" },   { "je", "2" },    { "jeu", "3" },   { "jef", "4" },
-            { "jg", "5" },    { "jgu", "6" },   { "jgf", "7" },   { "jl", "8" },    { "jlu", "9" },     { "jlf", "10" },
-            { "jne", "11" },  { "jneu", "12" }, { "jnef", "13" }, { "jge", "14" },  { "jgeu", "15" },   { "jgef", "16" },
-            { "jle", "17" },  { "jleu", "18" }, { "jlef", "19" }, { "print", "20"}, { "printu", "21" }, { "printf", "22" },
-            { "load", "23" }, { "neg", "24" },  { "negf", "25" }, { "cmp", "26" },  { "cmpu", "27" },   { "cmpf", "28" },
-            { "add", "29" },  { "addf", "30" }, { "sub", "31"},   { "subf", "32" }, { "mul", "33" },    { "mulf", "34" },
-            { "divu", "35" }, { "div", "36" },  { "divf", "37" }, { "modu", "38" }, { "mod", "39" },    { "inc", "40" },
-            { "dec", "41" },  { "read", "42" }, { "readu", "43"}, { "readf", "44"}, { "and", "45" },    { "or", "46" },
-            { "xor", "47" },  { "not", "48" },  { "loadr", "49" },{ "loadrv", "50"},{ "call", "51" },   { "loadf", "52" },
-            { "setf", "53" }, { "endp", "54" }
-        };
-
-        // Current address for replacing names with addresses
-        static uint16_t cur_address;
+        // Current address for replacing names with addresses.
+        // Every thread has its own, so the modules are translated in parallel (see Linker.cpp)
+        extern thread_local uint16_t cur_address;
 
         // Address for starting the program
-        static uint16_t start_prog_adrs;
+        extern thread_local uint16_t start_prog_adrs;
 
-        static IntExprSolver exprSolver;
+        // start_prog_adrs of a block translated without a "start" line before its "end"
+        constexpr uint16_t NO_START = 0xFFFF;
 
-        // Reading assembly code from a file
-        list<vector<string>> read_source_file(const string& source_file_path) noexcept;
+        extern thread_local IntExprSolver exprSolver;
 
-        // String parsing (first pass)
-        vector<string> parse_asm_line(const string& line_asm) noexcept;
+        // Reading assembly code from a file (first pass)
+        bool read_source_file(const string& source_file_path, Program& program) noexcept;
 
-        // Changing addresses using a split assembly line
-        void change_addresses_using_parts(vector<string>& parts) noexcept;
+        // Reading the whole file into a string
+        bool read_file(const string& file_path, string& text) noexcept;
+
+        // Splitting program.source into lines (first pass)
+        void parse_source(Program& program) noexcept;
 
-        // Parsing multiple lines with variable definitions
-        list<vector<string>> parse_var_definitions(std::ifstream& fin, vector<string>& first_var_def) noexcept;
+        // Translating a block of the source on its own from address 0 (first pass of the
+        // incremental translation). advance gets the address after the block, start the
+        // address of its last "start" line or NO_START
+        void translate_block(string_view text, Program& program, uint16_t& advance, uint16_t& start) noexcept;
 
-        // Replacing assembly keyword with code
-        string replace_substr_code(string& asm_key_word, const string& prev) noexcept;
+        // String parsing (first pass). The parts are added to the end of program.parts,
+        // returns their number
+        uint32_t parse_asm_line(string_view line_asm, Program& program) noexcept;
+
+        // Placing the variables of the data segment after the code (end of the first pass)
+        void place_data_segment(Program& program) noexcept;
+
+        // Changing addresses using a split assembly line
+        void change_addresses_using_parts(Program& program, uint32_t first, uint32_t& count) noexcept;
 
-        // Replacing an assembly directive with a shorter one
-        void replace_asm_dir(string& asm_key_word, const string& prev) noexcept;
+        // Parsing multiple lines with variable definitions. pos is the beginning of the next line
+        void parse_var_definitions(const char*& pos, const char* end, Program& program, CodeLine first_var_def) noexcept;
+
+        // Replacing assembly keyword (a command or a type) with code
+        string_view replace_substr_code(string_view asm_key_word, string_view prev, Program& program) noexcept;
 
         // Processing a new name or expression
-        void solve_asm_unknown_word(string& asm_key_word, const string& prev) noexcept;
+        string_view solve_asm_unknown_word(string_view asm_key_word, string_view prev, Program& program) noexcept;
+
+        // Solving the expressions with names (such as "table+2*4") after the first pass
+        bool solve_name_expressions(Program& program) noexcept;
+
+        // Peephole optimization after the first pass: removing the useless commands and moving
+        // the addresses of the names. What was changed is printed to stderr
+        void optimize_program(Program& program) noexcept;
 
         // Writing finished code to a file
-        bool write_target_file(const string& target_file_path, list<vector<string>>& code_lines) noexcept;
+        bool write_target_file(const string& target_file_path, const Program& program) noexcept;
+
+        // Writing finished code to a binary image file (see Image.cpp)
+        bool write_image_file(const string& target_file_path, const Program& program) noexcept;
+
+        // Encoding finished code as a binary image in memory
+        bool encode_image(const Program& program, string& image) noexcept;
+
+        // Parts of a finished line: names replaced with addresses, variable names dropped.
+        // prev is the last part of the previous line
+        void target_line_parts(const Program& program, const CodeLine& line, string_view& prev, vector<string_view>& parts);
 
         // Replacing a name with an address
-        string replace_name_address(const string& name);
+        string_view replace_name_address(const Program& program, string_view name) noexcept;
 
         // Is it possible after this word to replace the following with an address
-        bool is_next_changeable(const string& prev) noexcept;
+        bool is_next_changeable(string_view prev) noexcept;
 
         // Is a word a variable type
-        bool is_var_type(const string &name) noexcept;
+        bool is_var_type(string_view name) noexcept;
     }
 }
 
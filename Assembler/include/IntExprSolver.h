@@ -2,23 +2,44 @@
 #define INTEXPRSOLVER_H
 
 #include <string>
-#include <stack>
+#include <string_view>
+#include <unordered_map>
+#include <functional>
 #include <iostream>
 
 using std::string;
 
 class IntExprSolver {
 public:
-	// Expression Evaluation
-	int solve(const string& expr);
+	// Expression Evaluation. The values of the solved expressions are remembered,
+	// so an expression repeated in the program is evaluated once
+	int solve(std::string_view expr);
 
-	static bool is_expr(const string& expr) noexcept;
+	// Value of a name in an expression (the address of a label or a variable), false for an unknown name
+	using NameValue = std::function<bool(std::string_view name, int& value)>;
+
+	// Expression Evaluation in one pass over the expression, without allocating memory.
+	// The names of the expression are given their values by name_value
+	int evaluate(std::string_view expr, const NameValue* name_value = nullptr);
+
+	static bool is_expr(std::string_view expr) noexcept;
+
+	// Is a word an expression with names, such as "table+2*4" or "end_label-start_label".
+	// The names begin with a letter and consist of letters, digits and '_'
+	static bool is_symbolic_expr(std::string_view expr) noexcept;
+
+	// Operations (or operands) waiting in an expression at once
+	static constexpr int MAX_DEPTH = 64;
 
 private:
-	std::stack<int> values;		 // Expression values
-	std::stack<char> operations; // Expression Operations
-	string expr;			     // Expression
-	int may_unary;				 // Can the following operation be unary
+	std::unordered_map<string, int> solved; // Values of the solved expressions
+	string key;								// Expression being looked up (its memory is reused)
+
+	int values[MAX_DEPTH];		 // Expression values
+	int value_count;
+	char operations[MAX_DEPTH];	 // Expression Operations
+	int operation_count;
+	bool may_unary;				 // Can the following operation be unary
 
 	// Is a symbol an operation
 	static bool is_operation(const char ch) noexcept;
@@ -26,26 +47,32 @@ private:
 	// Getting the priority of an operation
 	static int oper_priority(const char ch) noexcept;
 
+	void push_value(int value);
+	int pop_value();
+
 	// Solving one element of an expression (1 or 2 operands and 1 operation)
-	void solve_operation() noexcept;
+	void solve_operation();
 
 	// Solving one element of an expression (2 operands and 1 operation)
-	void solve_two_operand_operation(const char& operation) noexcept;
+	void solve_two_operand_operation(const char& operation);
 
 
 	// Processing a character from a string indicating an operation
-	void operation_symbol_processing(char op) noexcept;
+	void operation_symbol_processing(char op);
 
 	// Processing a character from a string indicating a digit
-	void digit_symbol_processing(int& str_index) noexcept;
+	void digit_symbol_processing(std::string_view expr, size_t& str_index);
 
-	// Processing a character from a string indicating a closing parenthesis
-	void close_bracket_processing() noexcept;
+	// Processing a character from a string indicating the beginning of a name
+	void name_symbol_processing(std::string_view expr, size_t& str_index, const NameValue* name_value);
 
-	// Checking the correctness of parentheses
-	bool is_correct_brackets() const noexcept;
+	// Processing a character from a string indicating a closing parenthesis
+	void close_bracket_processing();
 };
 
+// Measuring the speed of the solver on a generated list of expressions
+void bench_expr_solver(unsigned expressions);
+
 class exprInvalidBracketsException : public std::exception
 {
 public:
@@ -64,6 +91,42 @@ public:
     }
 };
 
+class exprMissingOperandException : public std::exception
+{
+public:
+    virtual const char* what() const noexcept
+    {
+        return "Error evaluating expression. An operand is missing.";
+    }
+};
+
+class exprTooDeepException : public std::exception
+{
+public:
+    virtual const char* what() const noexcept
+    {
+        return "Error evaluating expression. The expression is nested too deeply.";
+    }
+};
+
+class exprNumberOutOfRangeException : public std::exception
+{
+public:
+    virtual const char* what() const noexcept
+    {
+        return "Error evaluating expression. A number is out of range.";
+    }
+};
+
+class exprUnknownNameException : public std::exception
+{
+public:
+    virtual const char* what() const noexcept
+    {
+        return "Error evaluating expression. An unknown name was found.";
+    }
+};
+
 class divByZeroException : public std::exception
 {
 public:
@@ -0,0 +1,90 @@
+#ifndef KEYWORDS_H
+#define KEYWORDS_H
+
+#include <cstdint>
+#include <iterator>
+#include <string_view>
+
+namespace assem
+{
+    // Keyword of the assembly language: a command or a type of variables
+    struct Keyword
+    {
+        std::string_view name;
+        int code;              // Code of the command (-1 for a type)
+        std::string_view text; // Text in the generated code (jumps get the way of finding the address)
+    };
+
+    inline constexpr Keyword keywords[] = {
+        { "end", 0, "0" },        { "jmp", 1, "1 0" },      { "je", 2, "2 0" },       { "jeu", 3, "3 0" },
+        { "jef", 4, "4 0" },      { "jg", 5, "5 0" },       { "jgu", 6, "6 0" },      { "jgf", 7, "7 0" },
+        { "jl", 8, "8 0" },       { "jlu", 9, "9 0" },      { "jlf", 10, "10 0" },    { "jne", 11, "11 0" },
+        { "jneu", 12, "12 0" },   { "jnef", 13, "13 0" },   { "jge", 14, "14 0" },    { "jgeu", 15, "15 0" },
+        { "jgef", 16, "16 0" },   { "jle", 17, "17 0" },    { "jleu", 18, "18 0" },   { "jlef", 19, "19 0" },
+        { "print", 20, "20" },    { "printu", 21, "21" },   { "printf", 22, "22" },   { "load", 23, "23" },
+        { "neg", 24, "24" },      { "negf", 25, "25" },     { "cmp", 26, "26" },      { "cmpu", 27, "27" },
+        { "cmpf", 28, "28" },     { "add", 29, "29" },      { "addf", 30, "30" },     { "sub", 31, "31" },
+        { "subf", 32, "32" },     { "mul", 33, "33" },      { "mulf", 34, "34" },     { "divu", 35, "35" },
+        { "div", 36, "36" },      { "divf", 37, "37" },     { "modu", 38, "38" },     { "mod", 39, "39" },
+        { "inc", 40, "40" },      { "dec", 41, "41" },      { "read", 42, "42" },     { "readu", 43, "43" },
+        { "readf", 44, "44" },    { "and", 45, "45" },      { "or", 46, "46" },       { "xor", 47, "47" },
+        { "not", 48, "48" },      { "loadr", 49, "49" },    { "loadrv", 50, "50" },   { "call", 51, "51" },
+        { "loadf", 52, "52" },    { "setf", 53, "53" },     { "endp", 54, "54" },
+        { "uint", -1, "u" },      { "int", -1, "i" },       { "float", -1, "f" }
+    };
+
+    namespace priv
+    {
+        // The keywords are placed into a table by a hash without collisions.
+        // Its seed is searched for by the compiler
+        constexpr uint32_t KEYWORD_SLOTS = 512;
+        constexpr uint8_t NO_KEYWORD = 0xFF;
+
+        constexpr uint32_t keyword_hash(std::string_view word, uint32_t seed) noexcept
+        {
+            uint32_t hash = seed;
+            for (char ch : word)
+                hash = (hash ^ uint8_t(ch)) * 16777619u;
+            return (hash ^ (hash >> 15)) & (KEYWORD_SLOTS - 1);
+        }
+
+        struct KeywordTable
+        {
+            uint32_t seed = 0;
+            uint8_t slots[KEYWORD_SLOTS] = {}; // Index of the keyword in a slot (NO_KEYWORD - empty)
+        };
+
+        constexpr KeywordTable make_keyword_table() noexcept
+        {
+            for (uint32_t seed = 2166136261u; ; seed++)
+            {
+                KeywordTable table;
+                table.seed = seed;
+                for (uint8_t& slot : table.slots)
+                    slot = NO_KEYWORD;
+                bool collision = false;
+                for (uint8_t i = 0; i < std::size(keywords) && !collision; i++)
+                {
+                    uint8_t& slot = table.slots[keyword_hash(keywords[i].name, seed)];
+                    collision = slot != NO_KEYWORD;
+                    slot = i;
+                }
+                if (!collision) return table;
+            }
+        }
+
+        inline constexpr KeywordTable keyword_table = make_keyword_table();
+    }
+
+    // Finding a keyword by its name (nullptr if the word is not a keyword)
+    constexpr const Keyword* find_keyword(std::string_view word) noexcept
+    {
+        uint8_t index = priv::keyword_table.slots[priv::keyword_hash(word, priv::keyword_table.seed)];
+        return index != priv::NO_KEYWORD && keywords[index].name == word ? &keywords[index] : nullptr;
+    }
+
+    static_assert(find_keyword("endp")->code == 54 && find_keyword("uint")->text == "u" && !find_keyword("start"),
+        "The keyword table is broken");
+}
+
+#endif // KEYWORDS_H
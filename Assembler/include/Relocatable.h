@@ -0,0 +1,134 @@
+#ifndef RELOCATABLE_H
+#define RELOCATABLE_H
+
+#include "Assembler.h"
+#include <cstring>
+#include <cstdint>
+
+// Relocatable form of the translated blocks of a program (see Relocatable.cpp). The
+// cache of the incremental translation and the object files of the modules are made
+// of block records, and the linker places the blocks one after another
+namespace assem::reloc
+{
+    constexpr uint32_t BLOCK_VERSION = 2; // Increased when the translation of a block changes
+
+    // Header of the files of block records (the cache and the object files)
+    struct FileHeader
+    {
+        char magic[4];
+        uint32_t version;
+        uint64_t blocks;
+    };
+
+    // Header of a block record. The arrays follow in this order
+    struct BlockHeader
+    {
+        uint64_t hash;        // Hash of the source of the block
+        uint32_t size;        // Bytes of the whole record
+        uint32_t names;       // Names defined in the block (Name)
+        uint32_t symbols;     // Names used and defined in the block (Symbol)
+        uint32_t references;  // The first symbols, used by the fixups
+        uint32_t text_fixups; // Fixups of the text (Fixup)
+        uint32_t word_fixups; // Fixups of the words (Fixup)
+        uint32_t words;       // Words of the image
+        uint32_t text_size;   // Bytes of the text
+        uint32_t pool_size;   // Bytes of the texts of the symbols
+        uint16_t advance;     // Cells taken by the block
+        uint16_t start;       // Offset of the last "start" line or NO_START
+        uint32_t flags;
+    };
+
+    constexpr uint32_t ENDS_WITH_TYPE = 1; // The last part of the block is a type, it drops the next one
+
+    struct Name
+    {
+        uint32_t symbol;
+        uint32_t address; // Offset in the block
+    };
+
+    struct Symbol
+    {
+        uint32_t offset; // In the pool of the block
+        uint32_t size;
+        uint64_t hash;   // Of the text, for the table of the names
+    };
+
+    // What is placed by a fixup
+    enum Source : uint8_t
+    {
+        NAME,        // Address of the symbol
+        BLOCK_START, // Start of the program before the block
+        LOCAL,       // Address in the block (a start or the end of variables), the offset is in the symbol field.
+                     // The addend is added after the address is wrapped to 16 bits, as the translation does
+        EXPRESSION   // Value of the expression with names in the symbol, solved when the names are placed
+    };
+
+    // How it is written into a word
+    enum Target : uint8_t
+    {
+        FIELD,   // (value & mask) << shift
+        INTEGER, // The whole word (integer variable)
+        FLOAT    // The whole word (fractional variable)
+    };
+
+    struct Fixup
+    {
+        uint32_t position; // Byte of the text or word of the image
+        uint32_t symbol;
+        uint8_t source;
+        uint8_t target;
+        uint8_t shift;
+        uint8_t reserved;
+        uint32_t mask;
+        uint32_t addend;
+    };
+
+    // Block record read from a file or made by the translation
+    struct Block
+    {
+        BlockHeader header;
+        const char* names;
+        const char* symbols;
+        const char* text_fixups;
+        const char* word_fixups;
+        const char* words;
+        const char* text;
+        const char* pool;
+        string_view record;
+    };
+
+    constexpr uint32_t NO_ADDRESS = 0xFFFFFFFF;
+
+    template <typename T>
+    T read_at(const char* pos, size_t i = 0) noexcept
+    {
+        T value;
+        std::memcpy(&value, pos + i * sizeof(T), sizeof(T));
+        return value;
+    }
+
+    // Reading a record, false if it goes beyond the data
+    bool open_block(string_view record, Block& block) noexcept;
+
+    // Text of a symbol of the block
+    string_view symbol_text(const Block& block, uint32_t i) noexcept;
+
+    // Hash of the source of a block
+    uint64_t hash_text(string_view text) noexcept;
+
+    // Cutting the source into blocks
+    vector<string_view> split_blocks(const string& source);
+
+    // Translating a block and adding its record to the end of record.
+    // false with the reason in error if the block cannot be placed on its own
+    bool build_block(string_view source, uint64_t hash, string& record, string& error);
+
+    // Placing the blocks one after another and patching the fixups.
+    // false with the reason in error if the blocks cannot be linked
+    bool link_blocks(const vector<Block>& blocks, bool need_text, string& text, string& image, string& error);
+
+    // Writing a file, the text or the binary data
+    bool write_file(const string& file_path, const string& data, bool binary) noexcept;
+}
+
+#endif // RELOCATABLE_H
@@ -17,28 +17,75 @@ string get_dir_from_filepath(char* first_argv)
     return cur_file_path.substr(0, i);
 }
 
-// Translating assembler into codes and running the program
-int asm_to_code_and_run(string cur_dir, string source_file, string target_file)
+// Translating assembler into codes and running the program in this process.
+// Without a target file the code is only kept in memory
+int asm_to_code_and_run(string source_file, string target_file, bool image, bool optimize, bool data_segment)
 {
-    int status = 1;
-    if (assem::asm_to_code(source_file, target_file))
-    {
-        // Starting the program
-        status = assem::run('\'' + cur_dir + string("/VirtualMachine9'"), target_file);
-    }
+    assem::Program program;
+    program.data_segment = data_segment;
+    if (!assem::translate(source_file, program, optimize)) return 1;
+    if (!target_file.empty() && !assem::write_code(program, target_file, image)) return 1;
+
+    // Starting the program
+    return assem::run(program);
+}
+
+// Translating only the changed blocks of the source, then running the program
+int asm_to_code_incremental_and_run(string source_file, string target_file, bool image, string cache_file)
+{
+    string program_image;
+    if (!assem::asm_to_code_incremental(source_file, target_file, image, cache_file, program_image)) return 1;
+    return assem::run_image(program_image);
+}
 
-    return status;
+// Linking modules (sources or object files), then running the program
+int link_and_run(const std::vector<string>& modules, string target_file, bool image)
+{
+    string program_image;
+    if (!assem::link_modules(modules, target_file, image, program_image)) return 1;
+    return assem::run_image(program_image);
 }
 
 int main(int argc, char **argv)
 {
     string cur_dir = get_dir_from_filepath(argv[0]);
 
+    // Decoding a trace of the virtual machine instead of translating a program
+    if (argc > 2 && string(argv[1]) == "--trace")
+        return assem::print_trace(argv[2], std::cout) ? 0 : 1;
+
+    // Options before the source file: --image (the code is written as a binary image
+    // instead of the text), --no-file (the code is not written, only run),
+    // --incremental (only the blocks changed since the last translation are translated),
+    // --object (the source is translated into the object file file.obj, nothing is run),
+    // --link (the files are the modules of one program, sources or object files),
+    // --bench-expr=N (speed of the expression solver on N generated expressions),
+    // -O (peephole optimization of the complete translation),
+    // --data-segment (the variables are placed after the code, without the Jumps over them)
+    bool image = false, write_file = true, incremental = false, object = false, link = false, optimize = false;
+    bool data_segment = false;
+    int first_arg = 1;
+    for (; first_arg < argc && (string(argv[first_arg]).rfind("--", 0) == 0 || string(argv[first_arg]) == "-O"); first_arg++)
+    {
+        if (string(argv[first_arg]) == "-O") optimize = true;
+        else if (string(argv[first_arg]) == "--image") image = true;
+        else if (string(argv[first_arg]) == "--no-file") write_file = false;
+        else if (string(argv[first_arg]) == "--incremental") incremental = true;
+        else if (string(argv[first_arg]) == "--object") object = true;
+        else if (string(argv[first_arg]) == "--link") link = true;
+        else if (string(argv[first_arg]) == "--data-segment") data_segment = true;
+        else if (string(argv[first_arg]).rfind("--bench-expr=", 0) == 0)
+        {
+            bench_expr_solver(unsigned(std::atoi(argv[first_arg] + 13)));
+            return 0;
+        }
+    }
+
     string source_file, source_dir;
-    if (argc > 1)
+    if (argc > first_arg)
     {
-        source_file = string(argv[1]);
-        source_dir = get_dir_from_filepath(argv[1]);
+        source_file = string(argv[first_arg]);
+        source_dir = get_dir_from_filepath(argv[first_arg]);
     }
     else // If there is no command line argument - work with the test file
     {
@@ -46,8 +93,15 @@ int main(int argc, char **argv)
         source_dir = cur_dir;
     }
 
-    string target_file = source_dir + string("/bin_code.txt");
+    string target_file = write_file ? source_dir + string(image ? "/bin_code.img" : "/bin_code.txt") : "";
 
     // Translating assembler into codes and running the program
-    return asm_to_code_and_run(cur_dir, source_file, target_file);
+    if (object)
+        return assem::assemble_object(source_file, assem::object_file_path(source_file)) ? 0 : 1;
+    if (link)
+        return link_and_run(argc > first_arg ? std::vector<string>(argv + first_arg, argv + argc) : std::vector<string>{source_file},
+            target_file, image);
+    if (incremental)
+        return asm_to_code_incremental_and_run(source_file, target_file, image, source_dir + string("/bin_code.cache"));
+    return asm_to_code_and_run(source_file, target_file, image, optimize, data_segment);
 }
@@ -1,102 +1,269 @@
 #include "Assembler.h"
+#include "processor.h"
+#include "image.h"
+#include <charconv>
+#include <cstring>
 
+// The state of the translation, one for every thread (see Assembler.h)
+thread_local uint16_t assem::priv::cur_address;
+thread_local uint16_t assem::priv::start_prog_adrs;
+thread_local IntExprSolver assem::priv::exprSolver;
 
 // Translation of an assembler program into codes
-bool assem::asm_to_code(const string& source_file_path, const string& target_file_path) noexcept
+bool assem::asm_to_code(const string& source_file_path, const string& target_file_path, bool image) noexcept
+{
+    Program program;
+    return translate(source_file_path, program) && write_code(program, target_file_path, image);
+}
+
+// Translation of an assembler program into codes kept in memory
+bool assem::translate(const string& source_file_path, Program& program, bool optimize) noexcept
 {
-    assem::priv::name_address = name_address_t();
     assem::priv::cur_address = 0;
+    assem::priv::start_prog_adrs = 0;
     assem::priv::exprSolver = IntExprSolver();
     // First pass
-    list<vector<string>> code_lines = priv::read_source_file(source_file_path);
-    // Second pass
-    return !code_lines.empty() && priv::write_target_file(target_file_path, code_lines);
+    if (!priv::read_source_file(source_file_path, program) || program.lines.empty()) return false;
+    if (optimize) priv::optimize_program(program);
+    // Texts of the addresses for replacing the names
+    for (auto& name : program.name_address)
+    {
+        char text[8];
+        std::to_chars_result result = std::to_chars(text, text + sizeof(text), name.second.address);
+        name.second.text = program.store(string_view(text, size_t(result.ptr - text)));
+    }
+    return priv::solve_name_expressions(program);
+}
+
+// Writing the translated program to a file (second pass)
+bool assem::write_code(const Program& program, const string& target_file_path, bool image) noexcept
+{
+    return image ? priv::write_image_file(target_file_path, program) : priv::write_target_file(target_file_path, program);
+}
+
+// Starting the program in the virtual machine of this process
+int assem::run(const Program& program)
+{
+    string image;
+    if (!priv::encode_image(program, image)) return 1;
+    return run_image(image);
 }
 
-// Starting the program
-int assem::run(const string& vm_path, const string& target_file_path)
+// Starting a program encoded as a binary image in the virtual machine of this process
+int assem::run_image(const string& image)
 {
-    return std::system((vm_path + " '" + target_file_path + '\'').c_str());
+    Processor proc = Processor();
+    uint16_t run_address = 0;
+    if (load_image(proc, image.data(), image.size(), run_address) != ImageStatus::Loaded)
+    {
+        std::cout << "Failed to load the program.\n";
+        return 1;
+    }
+    proc.run(run_address);
+    return 0;
 }
 
-// Reading assembly code from a file
-list<vector<string>> assem::priv::read_source_file(const string& source_file_path) noexcept
+namespace
 {
-    list<vector<string>> code_lines;
-    std::ifstream fin;
-    fin.open(source_file_path);
-    if (fin)
+    // Next line of the buffer without the line end. pos moves to the following line
+    string_view next_line(const char*& pos, const char* end) noexcept
+    {
+        const char* line_end = static_cast<const char*>(std::memchr(pos, '\n', size_t(end - pos)));
+        if (line_end == nullptr) line_end = end;
+        string_view line(pos, size_t(line_end - pos));
+        pos = line_end < end ? line_end + 1 : end;
+        return line;
+    }
+
+    // Sizes of the arrays of a program, counted over the source the way parse_asm_line splits it
+    struct SourceCounts
+    {
+        size_t parts = 0;
+        size_t lines = 0;
+        size_t var_lines = 0; // Lines beginning with a type, each can start a block with a Jump command
+    };
+
+    SourceCounts count_source(const string& source) noexcept
     {
-        string line;
-        while (std::getline(fin, line))
+        SourceCounts counts;
+        const char* pos = source.data();
+        const char* end = pos + source.size();
+        while (pos < end)
         {
-            auto codes_line = priv::parse_asm_line(line); // Splitting an assembly line into parts
-            if (codes_line.size() > 0 && codes_line[0] != "proc" && codes_line[0].back() != ':')
+            string_view line = next_line(pos, end);
+            counts.lines++;
+            size_t i = 0, words = 0;
+            while (i < line.size() && (line[i] == ' ' || line[i] == '\t')) i++;
+            while (i < line.size())
             {
-                // Parsing variable declarations
-                if (is_var_type(codes_line[0]))
-                {
-                    auto lines = parse_var_definitions(fin, codes_line);
-                    for (auto it = lines.begin(); it != lines.end(); it++)
-                        code_lines.push_back(*it);
-                }
-                else // Parsing strings of code
-                {
-                    codes_line.insert(codes_line.begin(), "k");
-                    code_lines.push_back(codes_line);
-                }
+                if (line[i] == ' ' || line[i] == ',') { i++; continue; }
+                size_t start = i;
+                while (i < line.size() && line[i] != ' ' && line[i] != ',') i++;
+                string_view word = line.substr(start, i - start);
+                if (words++ > 0) continue;
+                const assem::Keyword* keyword = assem::find_keyword(word);
+                if (assem::priv::is_var_type(keyword ? keyword->text : word))
+                    counts.var_lines++;
             }
+            counts.parts += words;
+        }
+        return counts;
+    }
+
+    // Removing the parts of a line that is not written, with their expressions
+    void drop_parts(assem::Program& program, uint32_t first)
+    {
+        program.parts.resize(first);
+        while (!program.expressions.empty() && program.expressions.back() >= first)
+            program.expressions.pop_back();
+    }
+
+    // Text of a number for the generated parts
+    string_view number_text(assem::Program& program, int number)
+    {
+        char text[16];
+        std::to_chars_result result = std::to_chars(text, text + sizeof(text), number);
+        return program.store(string_view(text, size_t(result.ptr - text)));
+    }
+}
+
+// Copying generated text into the arena
+string_view assem::Program::store(string_view text)
+{
+    char* copy = static_cast<char*>(arena.allocate(text.size() + 1, 1));
+    std::memcpy(copy, text.data(), text.size());
+    return string_view(copy, text.size());
+}
+
+// Reading assembly code from a file (first pass)
+bool assem::priv::read_source_file(const string& source_file_path, Program& program) noexcept
+{
+    if (!read_file(source_file_path, program.source))
+    {
+        std::cout << "Failed to open file \"" << source_file_path << "\" for reading.\n";
+        return false;
+    }
+    parse_source(program);
+    return true;
+}
+
+// Reading the whole file into a string
+bool assem::priv::read_file(const string& file_path, string& text) noexcept
+{
+    std::ifstream fin(file_path, std::ios::binary);
+    if (!fin) return false;
+    fin.seekg(0, std::ios::end);
+    text.resize(size_t(fin.tellg()));
+    fin.seekg(0);
+    fin.read(text.data(), std::streamsize(text.size()));
+    return true;
+}
+
+// Splitting program.source into lines (first pass)
+void assem::priv::parse_source(Program& program) noexcept
+{
+    // Every line can get the "k" part, and every block of variables the four parts of a Jump command
+    SourceCounts counts = count_source(program.source);
+    program.parts.reserve(counts.parts + counts.lines + 4 * counts.var_lines);
+    program.lines.reserve(counts.lines + counts.var_lines);
+
+    const char* pos = program.source.data();
+    const char* end = pos + program.source.size();
+    while (pos < end)
+    {
+        string_view line = next_line(pos, end);
+        uint32_t first = uint32_t(program.parts.size());
+        program.parts.push_back("k");
+        uint32_t count = priv::parse_asm_line(line, program); // Splitting an assembly line into parts
+        string_view head = count > 0 ? program.parts[first + 1] : string_view();
+        if (count > 0 && head != "proc" && head.back() != ':')
+        {
+            // Parsing variable declarations
+            if (is_var_type(head) && program.data_segment)
+                program.data_lines.push_back(CodeLine{ first + 1, count });
+            else if (is_var_type(head))
+                parse_var_definitions(pos, end, program, CodeLine{ first + 1, count });
+            else // Parsing strings of code
+                program.lines.push_back(CodeLine{ first, count + 1 });
         }
-        return code_lines;
+        else drop_parts(program, first); // The line is not written
     }
-    else std::cout << "Failed to open file \"" << source_file_path << "\" for reading.\n";
-    return code_lines;
+    if (program.data_segment) place_data_segment(program);
+}
+
+// Placing the variables of the data segment after the code
+void assem::priv::place_data_segment(Program& program) noexcept
+{
+    for (auto& name : program.name_address)
+        if (name.second.data) name.second.address += cur_address;
+    program.lines.insert(program.lines.end(), program.data_lines.begin(), program.data_lines.end());
+    cur_address += program.data_size;
+}
+
+// Translating a block of the source on its own from address 0
+void assem::priv::translate_block(string_view text, Program& program, uint16_t& advance, uint16_t& start) noexcept
+{
+    cur_address = 0;
+    start_prog_adrs = NO_START;
+    program.source.assign(text);
+    parse_source(program);
+    advance = cur_address;
+    start = start_prog_adrs;
 }
 
 // Parsing multiple lines with variable definitions
-list<vector<string>> assem::priv::parse_var_definitions(std::ifstream& fin, vector<string>& first_var_def) noexcept
+void assem::priv::parse_var_definitions(const char*& pos, const char* end, Program& program, CodeLine first_var_def) noexcept
 {
-    string line = ""; // the line to be read
+    uint16_t group_address = cur_address;
     int jmp_param = cur_address; // address parameter for the Jump command
 
     // offset of the current address due to the appearance of the Jump command before defining the variables
     cur_address += 2;
     // the definition address of the previously read variable is now 2 larger than it was (indentation for the Jump command)
-    name_address[first_var_def[1]] += 2;
-    auto code_lines = list<vector<string>> { first_var_def }; // strings with variable definitions
+    if (first_var_def.count > 1)
+        program.name_address[program.part(first_var_def, 1)].address += 2;
+    size_t jump_line = program.lines.size(); // place of the Jump command before the definitions
+    program.lines.push_back(CodeLine{ 0, 0 });
+    program.lines.push_back(first_var_def);
     bool is_var_def = true; // is the last line a variable definition
 
-    while (is_var_def && std::getline(fin, line))
+    while (is_var_def && pos < end)
     {
-        auto codes_line = parse_asm_line(line); // Splitting an assembly line into parts
-        if (codes_line.size() > 0)
+        string_view line = next_line(pos, end);
+        uint32_t first = uint32_t(program.parts.size());
+        program.parts.push_back("k");
+        uint32_t count = parse_asm_line(line, program); // Splitting an assembly line into parts
+        if (count > 0)
         {
             // Parsing variable declarations
-            if (is_var_type(codes_line[0]))
-                code_lines.push_back(codes_line);
+            if (is_var_type(program.parts[first + 1]))
+                program.lines.push_back(CodeLine{ first + 1, count });
             else // Parsing strings of code
             {
-                codes_line.insert(codes_line.begin(), "k");
-                code_lines.push_back(codes_line);
+                program.lines.push_back(CodeLine{ first, count + 1 });
                 is_var_def = false;
             }
             jmp_param += 2; // Jump should traverse one more line
         }
+        else drop_parts(program, first);
     }
 
     // Inserting a Jump Command
-    code_lines.push_front(vector<string> { "k", "1", "3", std::to_string(jmp_param) });
-    return code_lines;
+    uint32_t first = uint32_t(program.parts.size());
+    for (string_view part : { string_view("k"), string_view("1"), string_view("3"), number_text(program, jmp_param) })
+        program.parts.push_back(part);
+    program.local_addresses.push_back(LocalAddress{ first + 3, group_address });
+    program.lines[jump_line] = CodeLine{ first, 4 };
 }
 
 // String parsing (first pass)
-vector<string> assem::priv::parse_asm_line(const string& line_asm) noexcept
+uint32_t assem::priv::parse_asm_line(string_view line_asm, Program& program) noexcept
 {
-    vector<string> parts = vector<string>();
-    string substring = "", prev = "";
-    int i = 0;
-    while (line_asm[i] == ' ' || line_asm[i] == '\t') i++;
-    int j = i;
+    uint32_t first = uint32_t(program.parts.size());
+    string_view substring = "", prev = "";
+    size_t i = 0;
+    while (i < line_asm.size() && (line_asm[i] == ' ' || line_asm[i] == '\t')) i++;
+    size_t j = i;
     while (i < line_asm.size())
     {
         if (line_asm[i] == ' ' || line_asm[i] == ',')
@@ -105,8 +272,8 @@ vector<string> assem::priv::parse_asm_line(const string& line_asm) noexcept
             {
                 substring = line_asm.substr(j, i - j);
                 if (substring == "#") break;
-                substring = replace_substr_code(substring, prev);
-                parts.push_back(substring);
+                substring = replace_substr_code(substring, prev, program);
+                program.parts.push_back(substring);
                 prev = substring;
             }
             j = i + 1;
@@ -116,107 +283,138 @@ vector<string> assem::priv::parse_asm_line(const string& line_asm) noexcept
     if (i != j && substring != "#")
     {
         substring = line_asm.substr(j, i - j);
-        parts.push_back(replace_substr_code(substring, prev));
+        program.parts.push_back(replace_substr_code(substring, prev, program));
     }
 
-    change_addresses_using_parts(parts);
-    return parts;
+    uint32_t count = uint32_t(program.parts.size()) - first;
+    change_addresses_using_parts(program, first, count);
+    return count;
 }
 
 // Changing addresses using a split assembly line
-void assem::priv::change_addresses_using_parts(vector<string>& parts) noexcept
+void assem::priv::change_addresses_using_parts(Program& program, uint32_t first, uint32_t& count) noexcept
 {
-    if (parts.size() > 0)
+    if (count > 0)
     {
-        if (parts[0] == "start")
+        string_view head = program.parts[first];
+        if (head == "start")
         {
             start_prog_adrs = cur_address;
-            parts.clear();
+            drop_parts(program, first);
+            count = 0;
+        }
+        else if (head.back() != ':' && program.data_segment && is_var_type(head))
+        {
+            program.data_size += 2;
         }
-        else if (parts[0].back() != ':' && (std::isdigit(parts[0][0]) || is_var_type(parts[0])))
+        else if (head.back() != ':' && (std::isdigit(head[0]) || is_var_type(head)))
         {
             cur_address += 2;
         }
     }
 }
 
-// Replacing assembly keyword with code
-string assem::priv::replace_substr_code(string& asm_key_word, const string& prev) noexcept
+// Replacing assembly keyword (a command or a type) with code
+string_view assem::priv::replace_substr_code(string_view asm_key_word, string_view prev, Program& program) noexcept
 {
     if (asm_key_word == "") return "";
-    try
-    {
-        asm_key_word = command_code.at(asm_key_word);
-        int res_i = std::stoi(asm_key_word);
-        if (res_i < 20 && res_i > 0)
-            asm_key_word += " 0";
-        else if (res_i == 0)
-            asm_key_word += " " + std::to_string(start_prog_adrs);
-    }
-    catch (const std::out_of_range& ex)
+    const Keyword* keyword = find_keyword(asm_key_word);
+    if (keyword == nullptr)
+        return solve_asm_unknown_word(asm_key_word, prev, program);
+    if (keyword->code == 0)
     {
-        replace_asm_dir(asm_key_word, prev);
+        char text[16] = "0 ";
+        std::to_chars_result result = std::to_chars(text + 2, text + sizeof(text), start_prog_adrs);
+        return program.store(string_view(text, size_t(result.ptr - text)));
     }
-
-    return asm_key_word;
-}
-
-// Replacing an assembly directive with a shorter one
-void assem::priv::replace_asm_dir(string& asm_key_word, const string& prev) noexcept
-{
-    if (asm_key_word == "uint") asm_key_word = "u";
-    else if (asm_key_word == "int") asm_key_word = "i";
-    else if (asm_key_word == "float") asm_key_word = "f";
-    else solve_asm_unknown_word(asm_key_word, prev);
+    return keyword->text;
 }
 
 // Processing a new name or expression
-void assem::priv::solve_asm_unknown_word(string& asm_key_word, const string& prev) noexcept
+string_view assem::priv::solve_asm_unknown_word(string_view asm_key_word, string_view prev, Program& program) noexcept
 {
     // 1. The name must begin with a letter
     // 2. The previous word "prev" must allow the word to be replaced by the address
-    if (std::isalpha(asm_key_word[0]) && (is_next_changeable(prev) || asm_key_word[asm_key_word.size()-1] == ':') &&
-        command_code.find(asm_key_word) == command_code.end())
+    if (std::isalpha(asm_key_word[0]) && (is_next_changeable(prev) || asm_key_word.back() == ':') &&
+        find_keyword(asm_key_word) == nullptr)
     {
-        // Assigning an address for a keyword
-        if (asm_key_word[asm_key_word.size()-1] == ':')
-            name_address[asm_key_word.substr(0, asm_key_word.size() - 1)] = cur_address;
-        else name_address[asm_key_word] = cur_address;
+        // Assigning an address for a keyword. A variable of the data segment
+        // gets its offset in the segment, which is placed after the code
+        NameAddress& name = program.name_address[asm_key_word.back() == ':' ?
+            asm_key_word.substr(0, asm_key_word.size() - 1) : asm_key_word];
+        name.data = program.data_segment && is_var_type(prev);
+        name.address = name.data ? program.data_size : cur_address;
     }
     else if (IntExprSolver::is_expr(asm_key_word)) // Solving the expression
     {
-        asm_key_word = std::to_string(exprSolver.solve(asm_key_word));
+        // A plain number is its own value
+        bool plain = asm_key_word.size() < 10 && (asm_key_word[0] != '0' || asm_key_word.size() == 1);
+        for (char ch : asm_key_word)
+            plain = plain && std::isdigit(ch);
+        if (!plain)
+            return number_text(program, exprSolver.solve(asm_key_word));
     }
+    else if (IntExprSolver::is_symbolic_expr(asm_key_word))
+    {
+        // The addresses of the names are known after the first pass. The word becomes the next part
+        program.expressions.push_back(uint32_t(program.parts.size()));
+    }
+    return asm_key_word;
+}
+
+// Solving the expressions with names after the first pass, when all addresses are known
+bool assem::priv::solve_name_expressions(Program& program) noexcept
+{
+    IntExprSolver::NameValue name_value = [&program](string_view name, int& value)
+    {
+        auto found = program.name_address.find(name);
+        if (found == program.name_address.end()) return false;
+        value = found->second.address;
+        return true;
+    };
+    for (uint32_t part : program.expressions)
+    {
+        string_view expr = program.parts[part];
+        if (program.name_address.count(expr) > 0) continue; // A name that looks like an expression
+        try
+        {
+            program.parts[part] = number_text(program, exprSolver.evaluate(expr, &name_value));
+        }
+        catch (const std::exception& ex)
+        {
+            std::cout << "Failed to solve the expression \"" << expr << "\": " << ex.what() << '\n';
+            return false;
+        }
+    }
+    return true;
 }
 
 // Is it possible after this word to replace the following with an address
-bool assem::priv::is_next_changeable(const string& prev) noexcept
+bool assem::priv::is_next_changeable(string_view prev) noexcept
 {
     return prev == "proc" || is_var_type(prev);
 }
 
 // Is a word a variable type
-bool assem::priv::is_var_type(const string &name) noexcept
+bool assem::priv::is_var_type(string_view name) noexcept
 {
     return name == "u" || name == "i" || name == "f";
 }
 
 // Writing finished code to a file
-bool assem::priv::write_target_file(const string& target_file_path, list<vector<string>>& code_lines) noexcept
+bool assem::priv::write_target_file(const string& target_file_path, const Program& program) noexcept
 {
     std::ofstream fout;
     fout.open(target_file_path, std::ios::out | std::ios::trunc);
-    string prev = "";
+    string_view prev = "";
+    vector<string_view> parts;
     if (fout)
     {
-        for (auto it = code_lines.begin(); it != code_lines.end(); it++)
+        for (const CodeLine& line : program.lines)
         {
-            for (int i = 0; i < (*it).size(); i++)
-            {
-                if (!is_var_type(prev))
-                    fout << replace_name_address((*it)[i]) << ' ';
-                prev = (*it)[i];
-            }
+            target_line_parts(program, line, prev, parts);
+            for (string_view part : parts)
+                fout << part << ' ';
             fout << '\n';
         }
         return true;
@@ -225,15 +423,22 @@ bool assem::priv::write_target_file(const string& target_file_path, list<vector<
     return false;
 }
 
-// Replacing a name with an address
-string assem::priv::replace_name_address(const string& name)
+// Parts of a finished line: names replaced with addresses, variable names dropped
+void assem::priv::target_line_parts(const Program& program, const CodeLine& line, string_view& prev, vector<string_view>& parts)
 {
-    string res = name;
-    try
+    parts.clear();
+    for (uint32_t i = 0; i < line.count; i++)
     {
-        res = std::to_string(name_address.at(name));
+        string_view part = program.part(line, i);
+        if (!is_var_type(prev))
+            parts.push_back(replace_name_address(program, part));
+        prev = part;
     }
-    catch(std::exception ex) {};
-    return res;
 }
 
+// Replacing a name with an address
+string_view assem::priv::replace_name_address(const Program& program, string_view name) noexcept
+{
+    auto found = program.name_address.find(name);
+    return found != program.name_address.end() ? found->second.text : name;
+}
@@ -0,0 +1,144 @@
+#include "Assembler.h"
+#include "image.h"
+#include <cstring>
+#include <cctype>
+#include <cstdint>
+
+// Binary program image of the virtual machine (image.h of the virtual machine):
+// the header, then the segments, each with its address, number of words and the words.
+// The lines are turned into words as the loader of the virtual machine does with the text
+namespace
+{
+    struct Segment
+    {
+        uint16_t address;
+        vector<uint32_t> words;
+    };
+
+    // Numbers are short, so the strings for the standard conversions stay inside the string objects
+    int to_int(string_view text) { return std::stoi(string(text)); }
+
+    // Word of a variable line ("i", "u" or "f" and the value)
+    uint32_t variable_word(const vector<string_view>& parts)
+    {
+        if (parts.size() < 2) return 0;
+        if (parts[0] == "f")
+        {
+            float value = std::stof(string(parts[1]));
+            uint32_t word;
+            std::memcpy(&word, &value, sizeof(word));
+            return word;
+        }
+        return uint32_t(std::stoll(string(parts[1])));
+    }
+
+    // Word of a command line ("k", the code and the operands)
+    uint32_t command_word(const vector<string_view>& parts)
+    {
+        uint32_t code = to_int(parts[1]) & 0xFF;
+        if (parts.size() == 3) // A call takes an address, other commands a register
+            return code == 51 ? code | uint32_t(to_int(parts[2]) & 0xFFFF) << 16 : code | uint32_t(to_int(parts[2]) & 0xFF) << 24;
+        if (parts.size() == 4) // Register and address
+            return code | uint32_t(to_int(parts[2]) & 0xFF) << 8 | uint32_t(to_int(parts[3]) & 0xFFFF) << 16;
+        if (parts.size() > 4) // Three registers
+            return code | uint32_t(to_int(parts[2]) & 0xFF) << 8 | uint32_t(to_int(parts[3]) & 0xFF) << 16
+                | uint32_t(to_int(parts[4]) & 0xFF) << 24;
+        return code;
+    }
+}
+
+// Encoding finished code as a binary image in memory
+bool assem::priv::encode_image(const Program& program, string& image) noexcept
+{
+    vector<Segment> segments(1, Segment{0, {}});
+    uint16_t address = 0, entry = 0;
+    string_view prev = "";
+    vector<string_view> line_parts, parts;
+    try
+    {
+        for (const CodeLine& line : program.lines)
+        {
+            // A part can hold several numbers ("6 0" of a jump), so the parts are split
+            // by the spaces again, as the loader does with the text line
+            parts.clear();
+            target_line_parts(program, line, prev, line_parts);
+            for (string_view part : line_parts)
+            {
+                size_t start = 0;
+                while (start < part.size())
+                {
+                    size_t space = start;
+                    while (space < part.size() && !std::isspace(static_cast<unsigned char>(part[space]))) space++;
+                    if (space > start) parts.push_back(part.substr(start, space - start));
+                    start = space + 1;
+                }
+            }
+            if (parts.empty()) continue;
+            if (parts[0] == "a") // The following words go to a new segment
+            {
+                address = uint16_t(to_int(parts[1]));
+                segments.push_back(Segment{address, {}});
+                continue;
+            }
+
+            uint32_t word;
+            if (parts[0] == "i" || parts[0] == "u" || parts[0] == "f") word = variable_word(parts);
+            else if (parts[0] == "k") word = command_word(parts);
+            else if (parts[0] == "e")
+            {
+                entry = uint16_t(to_int(parts[1]) - 2);
+                word = 0;
+            }
+            else continue; // The line is not written to memory
+            segments.back().words.push_back(word);
+            address += 2;
+        }
+    }
+    catch (const std::exception& ex)
+    {
+        std::cout << "Failed to encode the image: " << ex.what() << '\n';
+        return false;
+    }
+
+    ImageHeader header;
+    std::memcpy(header.magic, "VM9I", 4);
+    header.version = IMAGE_VERSION;
+    header.segments = 0;
+    size_t size = sizeof(header);
+    for (const Segment& segment : segments)
+    {
+        if (segment.words.empty()) continue;
+        header.segments++;
+        size += sizeof(ImageSegment) + segment.words.size() * sizeof(uint32_t);
+    }
+    header.entry = entry;
+    header.reserved = 0;
+
+    image.clear();
+    image.reserve(size);
+    image.append(reinterpret_cast<const char*>(&header), sizeof(header));
+    for (const Segment& segment : segments)
+    {
+        if (segment.words.empty()) continue;
+        ImageSegment segment_header = { segment.address, uint16_t(segment.words.size()) };
+        image.append(reinterpret_cast<const char*>(&segment_header), sizeof(segment_header));
+        image.append(reinterpret_cast<const char*>(segment.words.data()), segment.words.size() * sizeof(uint32_t));
+    }
+    return true;
+}
+
+// Writing finished code to a binary image file
+bool assem::priv::write_image_file(const string& target_file_path, const Program& program) noexcept
+{
+    string image;
+    if (!encode_image(program, image)) return false;
+
+    std::ofstream fout(target_file_path, std::ios::out | std::ios::trunc | std::ios::binary);
+    if (!fout)
+    {
+        std::cout << "Failed to open file \"" << target_file_path << "\" for writing.\n";
+        return false;
+    }
+    fout.write(image.data(), std::streamsize(image.size()));
+    return bool(fout);
+}
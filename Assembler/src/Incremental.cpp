@@ -0,0 +1,169 @@
+#include "Relocatable.h"
+#include <unordered_map>
+#include <unordered_set>
+#include <algorithm>
+
+// Incremental translation. The records of the translated blocks of the source (see
+// Relocatable.cpp) are kept in the cache file under the hash of the source of the block,
+// so only the blocks that are not in the cache are translated. Then the blocks are linked.
+// Programs whose blocks cannot be linked on their own are translated completely as before
+namespace
+{
+    using namespace assem::reloc;
+    using assem::Program;
+
+    constexpr char CACHE_MAGIC[4] = {'A', '9', 'I', 'C'};
+
+    // The cache file: the header, the index of the records sorted by the hash, the records
+    struct CacheEntry
+    {
+        uint64_t hash;
+        uint64_t offset; // Of the record in the file
+    };
+
+    // Records of the cache file found by the hash of the source of a block.
+    // They are read only for the blocks of the program, an unreadable cache is empty
+    class Cache
+    {
+    public:
+        void read(const string& file_path)
+        {
+            if (!assem::priv::read_file(file_path, data) || data.size() < sizeof(FileHeader)) return;
+            FileHeader header = read_at<FileHeader>(data.data());
+            if (std::memcmp(header.magic, CACHE_MAGIC, 4) != 0 || header.version != BLOCK_VERSION ||
+                header.blocks > (data.size() - sizeof(header)) / sizeof(CacheEntry)) return;
+            index = data.data() + sizeof(header);
+            count = size_t(header.blocks);
+
+            // The hashes are spread evenly, so the top bits of a hash give its place in the index
+            while ((size_t(1) << bits) < count) bits++;
+            buckets.assign((size_t(1) << bits) + 1, uint32_t(count));
+            for (size_t i = count; i-- > 0; )
+                buckets[bucket(read_at<CacheEntry>(index, i).hash)] = uint32_t(i);
+            for (size_t i = buckets.size() - 1; i-- > 0; )
+                buckets[i] = std::min(buckets[i], buckets[i + 1]);
+        }
+
+        bool find(uint64_t hash, Block& block) const noexcept
+        {
+            if (count == 0) return false;
+            size_t low = buckets[bucket(hash)], high = buckets[bucket(hash) + 1];
+            while (low < high)
+            {
+                size_t middle = (low + high) / 2;
+                CacheEntry entry = read_at<CacheEntry>(index, middle);
+                if (entry.hash < hash) low = middle + 1;
+                else if (entry.hash > hash) high = middle;
+                else return entry.offset <= data.size() && open_block(string_view(data).substr(entry.offset), block)
+                    && block.header.hash == hash;
+            }
+            return false;
+        }
+
+        size_t size() const noexcept { return count; }
+
+    private:
+        size_t bucket(uint64_t hash) const noexcept { return bits == 0 ? 0 : size_t(hash >> (64 - bits)); }
+
+        string data;
+        const char* index = nullptr;
+        size_t count = 0;
+        unsigned bits = 0;
+        vector<uint32_t> buckets; // First entry of every bucket
+    };
+
+    // Writing the records of the blocks of the program in the order of the program, so that
+    // the next translation reads them one after another. Nothing is written if the cache holds them all
+    void write_cache(const string& file_path, const vector<Block>& blocks, const Cache& cache, bool changed)
+    {
+        vector<CacheEntry> entries;
+        entries.reserve(blocks.size());
+        std::unordered_set<uint64_t> written;
+        size_t size = 0;
+        for (const Block& block : blocks)
+            if (written.insert(block.header.hash).second)
+            {
+                entries.push_back(CacheEntry{ block.header.hash, size });
+                size += block.record.size();
+            }
+        if (!changed && entries.size() == cache.size()) return;
+
+        FileHeader header = { {CACHE_MAGIC[0], CACHE_MAGIC[1], CACHE_MAGIC[2], CACHE_MAGIC[3]}, BLOCK_VERSION, entries.size() };
+        size_t records = sizeof(header) + entries.size() * sizeof(CacheEntry);
+        string data;
+        data.reserve(records + size);
+        data.resize(records);
+        written.clear();
+        for (const Block& block : blocks)
+            if (written.insert(block.header.hash).second) data.append(block.record);
+        for (CacheEntry& entry : entries)
+            entry.offset += records;
+        std::sort(entries.begin(), entries.end(), [](const CacheEntry& a, const CacheEntry& b) { return a.hash < b.hash; });
+        std::memcpy(&data[0], &header, sizeof(header));
+        std::memcpy(&data[sizeof(header)], entries.data(), entries.size() * sizeof(CacheEntry));
+        write_file(file_path, data, true);
+    }
+
+    // Complete translation for the programs whose blocks cannot be placed on their own
+    bool translate_completely(const string& source_file_path, const string& target_file_path, bool image, string& program_image) noexcept
+    {
+        Program program;
+        return assem::translate(source_file_path, program) &&
+            (target_file_path.empty() || assem::write_code(program, target_file_path, image)) &&
+            assem::priv::encode_image(program, program_image);
+    }
+} // namespace
+
+// Incremental translation of an assembler program into codes
+bool assem::asm_to_code_incremental(const string& source_file_path, const string& target_file_path, bool image,
+    const string& cache_file_path, string& program_image) noexcept
+{
+    try
+    {
+        string source, fresh, error;
+        if (!priv::read_file(source_file_path, source))
+        {
+            std::cout << "Failed to open file \"" << source_file_path << "\" for reading.\n";
+            return false;
+        }
+        Cache cache;
+        cache.read(cache_file_path);
+
+        // Blocks that are not in the cache are translated into new records
+        vector<string_view> sources = split_blocks(source);
+        vector<Block> blocks(sources.size());
+        vector<std::pair<size_t, size_t>> fresh_blocks; // Block and the offset of its record in fresh
+        std::unordered_map<uint64_t, size_t> fresh_offsets;
+        for (size_t i = 0; i < sources.size(); i++)
+        {
+            uint64_t hash = hash_text(sources[i]);
+            if (cache.find(hash, blocks[i])) continue;
+            auto found = fresh_offsets.find(hash);
+            if (found == fresh_offsets.end())
+            {
+                found = fresh_offsets.emplace(hash, fresh.size()).first;
+                if (!build_block(sources[i], hash, fresh, error))
+                    return translate_completely(source_file_path, target_file_path, image, program_image);
+            }
+            fresh_blocks.push_back({ i, found->second });
+        }
+        // The new records are views into fresh, which has stopped growing
+        for (const auto& fresh_block : fresh_blocks)
+            open_block(string_view(fresh).substr(fresh_block.second), blocks[fresh_block.first]);
+
+        string text;
+        if (!link_blocks(blocks, !image && !target_file_path.empty(), text, program_image, error))
+            return translate_completely(source_file_path, target_file_path, image, program_image);
+        if (!target_file_path.empty() && !write_file(target_file_path, image ? program_image : text, image))
+            return false;
+
+        // The cache keeps the blocks of this version of the source
+        write_cache(cache_file_path, blocks, cache, !fresh_blocks.empty());
+        return true;
+    }
+    catch (const std::exception& ex)
+    {
+        std::cout << "Failed to translate the program: " << ex.what() << '\n';
+        return false;
+    }
+}
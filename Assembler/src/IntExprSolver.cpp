@@ -1,21 +1,35 @@
 #include "IntExprSolver.h"
+#include <chrono>
+#include <climits>
+#include <cstdint>
+#include <cstdio>
+#include <cctype>
+#include <vector>
 
 // Expression Evaluation
-int IntExprSolver::solve(const string& expr) {
-	this->expr = expr;
-	if (!is_correct_brackets())
-        throw exprInvalidBracketsException();
+int IntExprSolver::solve(std::string_view expr) {
+	key.assign(expr.data(), expr.size());
+	auto found = solved.find(key);
+	if (found != solved.end()) return found->second;
+
+	int value = evaluate(expr);
+	solved.emplace(key, value);
+	return value;
+}
 
-	operations = std::stack<char>();
-	values = std::stack<int>();
+// Expression Evaluation in one pass: the brackets are checked while the expression is solved
+int IntExprSolver::evaluate(std::string_view expr, const NameValue* name_value) {
+	operation_count = 0;
+	value_count = 0;
 	may_unary = true; // Can an operation be unary
 
 	// Translating an expression into reverse Polish notation with
 	// parallel evaluation of expressions in parentheses
-	for (int i = 0; i < expr.size(); i++) {
+	for (size_t i = 0; i < expr.size(); i++) {
 		if (expr[i] != ' ') {
 			if (expr[i] == '(') {
-				operations.push('('); may_unary = true;
+				if (operation_count == MAX_DEPTH) throw exprTooDeepException();
+				operations[operation_count++] = '('; may_unary = true;
 			}
 			else if (expr[i] == ')') {
 				close_bracket_processing();
@@ -23,19 +37,26 @@ int IntExprSolver::solve(const string& expr) {
 			else if (is_operation(expr[i])) {
 				operation_symbol_processing(expr[i]);
 			}
-			else if (isdigit(expr[i])) {
-				digit_symbol_processing(i);
+			else if (expr[i] >= '0' && expr[i] <= '9') {
+				digit_symbol_processing(expr, i);
+			}
+			else if (std::isalpha(static_cast<unsigned char>(expr[i]))) {
+				name_symbol_processing(expr, i, name_value);
 			}
 			else throw exprOtherSymbolException();
 		}
 	}
 
-	while (!operations.empty()) solve_operation();
+	while (operation_count > 0) {
+		if (operations[operation_count - 1] == '(') throw exprInvalidBracketsException();
+		solve_operation();
+	}
+	if (value_count != 1) throw exprMissingOperandException();
 
-	return values.top();
+	return values[0];
 }
 
-bool IntExprSolver::is_expr(const string& expr) noexcept
+bool IntExprSolver::is_expr(std::string_view expr) noexcept
 {
     for (char ch : expr)
     {
@@ -46,59 +67,96 @@ bool IntExprSolver::is_expr(const string& expr) noexcept
     return true;
 }
 
-// Checking the correctness of parentheses
-bool IntExprSolver::is_correct_brackets() const noexcept {
-	auto brackets = std::stack<char>();
-	for (char ch : expr) {
-		if (ch == '(') {
-			brackets.push('(');
-		}
-		else if (ch == ')') {
-			if (brackets.empty()) return false;
-			brackets.pop();
-		}
-	}
+// Is a word an expression with names
+bool IntExprSolver::is_symbolic_expr(std::string_view expr) noexcept
+{
+    bool name = false, operation = false;
+    for (size_t i = 0; i < expr.size(); )
+    {
+        unsigned char ch = static_cast<unsigned char>(expr[i]);
+        if (std::isalnum(ch) || ch == '_')
+        {
+            // A word beginning with a digit is a number ("1e5" is not a name)
+            bool number = std::isdigit(ch);
+            for (; i < expr.size() && (std::isalnum(static_cast<unsigned char>(expr[i])) || expr[i] == '_'); i++)
+                if (number && !std::isdigit(static_cast<unsigned char>(expr[i]))) return false;
+            name = name || !number;
+        }
+        else if (is_operation(ch) || ch == '(' || ch == ')')
+        {
+            operation = true;
+            i++;
+        }
+        else return false;
+    }
+    return name && operation;
+}
+
+void IntExprSolver::push_value(int value) {
+	if (value_count == MAX_DEPTH) throw exprTooDeepException();
+	values[value_count++] = value;
+}
 
-	return brackets.empty();
+int IntExprSolver::pop_value() {
+	if (value_count == 0) throw exprMissingOperandException();
+	return values[--value_count];
 }
 
 // Processing a character from a string indicating an operation
-void IntExprSolver::operation_symbol_processing(char op) noexcept {
+void IntExprSolver::operation_symbol_processing(char op) {
 	if (may_unary && (op == '-' || op == '+')) op = -op;
 	int curr_prior = oper_priority(op); // Operation priority
 
 	// Execute all recent operations on the stack with a priority higher than the current operation
-	while (!operations.empty() &&
-		((op >= 0 && oper_priority(operations.top()) >= curr_prior) ||
-			(op < 0 && oper_priority(operations.top()) > curr_prior))
+	while (operation_count > 0 &&
+		((op >= 0 && oper_priority(operations[operation_count - 1]) >= curr_prior) ||
+			(op < 0 && oper_priority(operations[operation_count - 1]) > curr_prior))
 		) solve_operation();
 
-	operations.push(op); // Add current operation to the stack
+	if (operation_count == MAX_DEPTH) throw exprTooDeepException();
+	operations[operation_count++] = op; // Add current operation to the stack
 	may_unary = true;
 }
 
 // Processing a character from a string denoting a digit
-void IntExprSolver::digit_symbol_processing(int& str_index) noexcept {
+void IntExprSolver::digit_symbol_processing(std::string_view expr, size_t& str_index) {
 	// If a digit is found, then take subsequent digits and convert
 	// them to type Int to create an operand. Place the operand on the stack
-	int start_digit = str_index;
-	while (str_index < expr.size() && isdigit(expr[str_index])) str_index++;
-	int count_digits = str_index - start_digit;
+	int64_t operand = 0;
+	for (; str_index < expr.size() && expr[str_index] >= '0' && expr[str_index] <= '9'; str_index++) {
+		operand = operand * 10 + (expr[str_index] - '0');
+		if (operand > INT_MAX) throw exprNumberOutOfRangeException();
+	}
+	str_index--;
+
+	push_value(int(operand));
+	may_unary = false;
+}
+
+// Processing a character from a string indicating the beginning of a name.
+// The value of the name is placed on the stack as an operand
+void IntExprSolver::name_symbol_processing(std::string_view expr, size_t& str_index, const NameValue* name_value) {
+	size_t start_name = str_index;
+	while (str_index < expr.size() && (std::isalnum(static_cast<unsigned char>(expr[str_index])) || expr[str_index] == '_'))
+		str_index++;
+	std::string_view name = expr.substr(start_name, str_index - start_name);
 	str_index--;
 
-	int operand = stoi(expr.substr(start_digit, count_digits));
-	values.push(operand);
+	int operand = 0;
+	if (name_value == nullptr || !(*name_value)(name, operand)) throw exprUnknownNameException();
+	push_value(operand);
 	may_unary = false;
 }
 
 // Processing a character from a string indicating a closing parenthesis
-void IntExprSolver::close_bracket_processing() noexcept {
+void IntExprSolver::close_bracket_processing() {
 	// If a closing parenthesis is found, then calculate everything up
 	// to the first opening one, and remove the parentheses themselves
-	while (!operations.empty() && operations.top() != '(')
+	while (operation_count > 0 && operations[operation_count - 1] != '(')
 		solve_operation();
 
-	operations.pop();
+	if (operation_count == 0) throw exprInvalidBracketsException();
+	operation_count--;
 	may_unary = false;
 }
 
@@ -117,17 +175,16 @@ int IntExprSolver::oper_priority(const char ch) noexcept {
 }
 
 // Solving one element of an expression (2 operands and 1 operation)
-void IntExprSolver::solve_operation() noexcept {
-	char operation = operations.top();
-	operations.pop();
+void IntExprSolver::solve_operation() {
+	char operation = operations[--operation_count];
 
-	if (-operation == '+')
-		return; // Unary plus is not processed
+	if (-operation == '+') {
+		if (value_count == 0) throw exprMissingOperandException();
+		return; // Unary plus does not change the operand
+	}
 
 	if (-operation == '-') { // Unary minus
-		int value = values.top();
-		values.pop();
-		values.push(-value);
+		push_value(int(0u - uint32_t(pop_value())));
 	}
 	else { // Binary operations
 		solve_two_operand_operation(operation);
@@ -135,32 +192,63 @@ void IntExprSolver::solve_operation() noexcept {
 }
 
 // Solving one element of an expression (2 operands and 1 operation)
-void IntExprSolver::solve_two_operand_operation(const char& operation) noexcept {
+void IntExprSolver::solve_two_operand_operation(const char& operation) {
 	// Getting Operands
-	int right_val = values.top();
-	values.pop();
-	int left_val = values.top();
-	values.pop();
+	int right_val = pop_value();
+	int left_val = pop_value();
 
-	// Performing an operation with operands.
-	// The result is pushed onto the stack as a new operand.
+	// Performing an operation with operands. The result is pushed onto the stack
+	// as a new operand. The overflows wrap around instead of being undefined
 	switch (operation) {
 	case '+':
-		values.push(left_val + right_val);
+		push_value(int(uint32_t(left_val) + uint32_t(right_val)));
 		break;
 	case '-':
-		values.push(left_val - right_val);
+		push_value(int(uint32_t(left_val) - uint32_t(right_val)));
 		break;
 	case '*':
-		values.push(left_val * right_val);
+		push_value(int(uint32_t(left_val) * uint32_t(right_val)));
 		break;
 	case '/':
 	    if (right_val == 0) throw divByZeroException();
-		values.push(left_val / right_val);
+		push_value(right_val == -1 ? int(0u - uint32_t(left_val)) : left_val / right_val);
 		break;
 	case '%':
 	    if (right_val == 0) throw divByZeroException();
-		values.push(left_val % right_val);
+		push_value(right_val == -1 ? 0 : left_val % right_val);
 		break;
 	}
 }
+
+// Measuring the speed of the solver on a generated list of expressions. Distinct expressions
+// are evaluated every time, in a list of few expressions repeated many times (as in the
+// generated sources) the values are taken from the solved ones
+void bench_expr_solver(unsigned expressions)
+{
+	std::vector<string> distinct, repeated;
+	distinct.reserve(expressions);
+	repeated.reserve(expressions);
+	char text[64];
+	for (unsigned i = 0; i < expressions; i++) {
+		std::snprintf(text, sizeof(text), "(%u+%u)*%u-(-%u)/(%u%%7+1)", i, i % 97, i % 13 + 1, i / 3, i);
+		distinct.push_back(text);
+		repeated.push_back(distinct[i % 64]);
+	}
+
+	using Clock = std::chrono::steady_clock;
+	long long sum = 0;
+	auto measure = [&](const char* name, const std::vector<string>& list, bool memo)
+	{
+		IntExprSolver solver;
+		Clock::time_point start = Clock::now();
+		for (const string& expr : list)
+			sum += memo ? solver.solve(expr) : solver.evaluate(expr);
+		double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+		std::cout << name << ": " << list.size() / seconds / 1e6 << " million expressions per second\n";
+	};
+	std::cout << "Expressions: " << expressions << '\n';
+	measure("Evaluation of distinct expressions", distinct, false);
+	measure("Solving distinct expressions", distinct, true);
+	measure("Solving repeated expressions", repeated, true);
+	if (sum == 1) std::cout << '\n'; // The results are used
+}
@@ -0,0 +1,156 @@
+#include "Relocatable.h"
+#include <filesystem>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+
+// Programs made of several modules. A module is translated into an object file: the records
+// of its blocks (see Relocatable.cpp) in the order of the source. The names defined in the
+// blocks are exported to the other modules, the names used are left as fixups for the linker,
+// and the addresses inside a block (the jumps over variables, the "start" lines) are moved
+// with the block. The linker places the blocks of the modules one after another in the order
+// of the list, so the program works as if the sources were joined into one file
+namespace
+{
+    using namespace assem::reloc;
+    namespace fs = std::filesystem;
+
+    constexpr char OBJECT_MAGIC[4] = {'A', '9', 'I', 'O'};
+
+    bool is_object_file(const string& file_path)
+    {
+        return fs::path(file_path).extension() == ".obj";
+    }
+
+    // The object file is missing, older than its source or made by another version of the assembler
+    bool is_outdated(const string& source_file_path, const string& object_file_path)
+    {
+        std::error_code error;
+        fs::file_time_type object_time = fs::last_write_time(object_file_path, error);
+        if (error) return true;
+        fs::file_time_type source_time = fs::last_write_time(source_file_path, error);
+        if (error || object_time < source_time) return true;
+
+        FileHeader header;
+        std::ifstream fin(object_file_path, std::ios::binary);
+        return !fin.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+            std::memcmp(header.magic, OBJECT_MAGIC, 4) != 0 || header.version != BLOCK_VERSION;
+    }
+
+    // Reading the blocks of an object file, data keeps their records
+    bool read_object(const string& file_path, string& data, vector<Block>& blocks)
+    {
+        if (!assem::priv::read_file(file_path, data))
+        {
+            std::cout << "Failed to open file \"" << file_path << "\" for reading.\n";
+            return false;
+        }
+        bool valid = data.size() >= sizeof(FileHeader);
+        if (valid)
+        {
+            FileHeader header = read_at<FileHeader>(data.data());
+            valid = std::memcmp(header.magic, OBJECT_MAGIC, 4) == 0 && header.version == BLOCK_VERSION;
+            size_t offset = sizeof(header);
+            for (uint64_t i = 0; valid && i < header.blocks; i++)
+            {
+                Block block;
+                valid = offset <= data.size() && open_block(string_view(data).substr(offset), block);
+                if (valid)
+                {
+                    blocks.push_back(block);
+                    offset += block.header.size;
+                }
+            }
+        }
+        if (!valid) std::cout << "File \"" << file_path << "\" is not an object file of this version of the assembler.\n";
+        return valid;
+    }
+}
+
+// Path of the object file of a module: the source with the extension .obj
+string assem::object_file_path(const string& source_file_path)
+{
+    return fs::path(source_file_path).replace_extension(".obj").string();
+}
+
+// Translation of a module into an object file
+bool assem::assemble_object(const string& source_file_path, const string& object_file_path) noexcept
+{
+    try
+    {
+        string source, data, error;
+        if (!priv::read_file(source_file_path, source))
+        {
+            std::cout << "Failed to open file \"" << source_file_path << "\" for reading.\n";
+            return false;
+        }
+        vector<string_view> sources = split_blocks(source);
+        data.resize(sizeof(FileHeader));
+        for (string_view block_source : sources)
+            if (!build_block(block_source, hash_text(block_source), data, error))
+            {
+                // One message at once, the modules are translated in parallel
+                std::cout << "Failed to assemble \"" + source_file_path + "\": " + error + '\n';
+                return false;
+            }
+        FileHeader header = { {OBJECT_MAGIC[0], OBJECT_MAGIC[1], OBJECT_MAGIC[2], OBJECT_MAGIC[3]}, BLOCK_VERSION, sources.size() };
+        std::memcpy(&data[0], &header, sizeof(header));
+        return write_file(object_file_path, data, true);
+    }
+    catch (const std::exception& ex)
+    {
+        std::cout << "Failed to assemble \"" + source_file_path + "\": " + ex.what() + '\n';
+        return false;
+    }
+}
+
+// Linking modules into one program
+bool assem::link_modules(const vector<string>& module_file_paths, const string& target_file_path, bool image,
+    string& program_image) noexcept
+{
+    try
+    {
+        // Object files of the modules, the outdated ones are translated again
+        vector<string> objects;
+        vector<size_t> outdated;
+        for (const string& module : module_file_paths)
+        {
+            objects.push_back(is_object_file(module) ? module : object_file_path(module));
+            if (!is_object_file(module) && is_outdated(module, objects.back())) outdated.push_back(objects.size() - 1);
+        }
+        std::atomic<size_t> next{0};
+        std::atomic<bool> assembled{true};
+        auto worker = [&]()
+        {
+            for (size_t i = next++; i < outdated.size(); i = next++)
+                if (!assemble_object(module_file_paths[outdated[i]], objects[outdated[i]])) assembled = false;
+        };
+        size_t thread_count = std::min<size_t>(std::max(1u, std::thread::hardware_concurrency()), outdated.size());
+        vector<std::thread> threads;
+        for (size_t i = 1; i < thread_count; i++)
+            threads.emplace_back(worker);
+        worker();
+        for (std::thread& thread : threads)
+            thread.join();
+        if (!assembled) return false;
+
+        // The blocks of all modules in the order of the list
+        vector<string> data(objects.size());
+        vector<Block> blocks;
+        for (size_t i = 0; i < objects.size(); i++)
+            if (!read_object(objects[i], data[i], blocks)) return false;
+
+        string text, error;
+        if (!link_blocks(blocks, !image && !target_file_path.empty(), text, program_image, error))
+        {
+            std::cout << "Failed to link the program: " << error << '\n';
+            return false;
+        }
+        return target_file_path.empty() || write_file(target_file_path, image ? program_image : text, image);
+    }
+    catch (const std::exception& ex)
+    {
+        std::cout << "Failed to link the program: " << ex.what() << '\n';
+        return false;
+    }
+}
@@ -0,0 +1,215 @@
+#include "Assembler.h"
+#include <algorithm>
+#include <charconv>
+#include <cctype>
+#include <iostream>
+
+// Peephole optimization of a program (the -O option). It runs after the first pass, when the
+// names have their addresses but the lines still hold the names, so lines can be removed and
+// the names moved to the new addresses before the second pass replaces them. Every line takes
+// two cells, so the line of an address is the address / 2. Removed lines:
+// - jmp to the next instruction,
+// - load of an address register that the next load of the same register replaces,
+// - loadrv from a location onto itself.
+// Jumps to a jmp are directed to its target (jump threading)
+namespace
+{
+    using assem::Program;
+    using assem::CodeLine;
+
+    struct PeepholeCounts
+    {
+        size_t jumps_to_next = 0;
+        size_t replaced_loads = 0;
+        size_t loads_onto_itself = 0;
+        size_t threaded_jumps = 0;
+    };
+
+    // Jumps are written with the way of finding the address: "1 0" is jmp to a direct address
+    bool is_direct_jump(string_view code) noexcept
+    {
+        return code.size() > 2 && code.substr(code.size() - 2) == " 0";
+    }
+
+    // Part taken from the source as it is, not made from a keyword
+    bool from_source(const Program& program, string_view part) noexcept
+    {
+        return part.data() >= program.source.data() && part.data() < program.source.data() + program.source.size();
+    }
+
+    // The address part of a command is a name, so it is moved with the name
+    bool is_movable(const Program& program, const CodeLine& line, uint32_t i)
+    {
+        return program.name_address.count(program.part(line, i)) > 0;
+    }
+
+    // Reason why the addresses of the program cannot be moved, empty if they can
+    string check_program(const Program& program)
+    {
+        for (string_view head : { "k", "i", "u", "f" })
+            if (program.name_address.count(head) > 0)
+                return "the name \"" + string(head) + "\" is the first part of the lines";
+        // "loop+4" or "end-start" depends on the lines between the addresses, which may be removed
+        if (!program.expressions.empty())
+            return "an expression uses the addresses of names";
+        for (const CodeLine& line : program.lines)
+        {
+            string_view head = program.part(line, 0);
+            // The type at the end of a line drops the first part of the next line
+            if (assem::priv::is_var_type(program.part(line, line.count - 1)) && line.count > 1)
+                return "a line ends with a type";
+            if (assem::priv::is_var_type(head)) continue;
+            string_view code = line.count > 1 ? program.part(line, 1) : string_view();
+            if (head != "k" || code.empty() || !std::isdigit(static_cast<unsigned char>(code[0])))
+                return "a line begins with \"" + string(code.empty() ? head : code) + "\"";
+            if (from_source(program, code))
+                return "a command is written as a code";
+            if ((is_direct_jump(code) || code == "23" || code == "51") && line.count > 2 && !is_movable(program, line, line.count - 1))
+                return "the address \"" + string(program.part(line, line.count - 1)) + "\" is written as a number";
+        }
+        return "";
+    }
+
+    // Address of a name, -1 for the other parts
+    long name_address(const Program& program, string_view part)
+    {
+        auto found = program.name_address.find(part);
+        return found != program.name_address.end() ? long(found->second.address) : -1;
+    }
+
+    bool is_command(const Program& program, const CodeLine& line, string_view code, uint32_t count)
+    {
+        return line.count == count && program.part(line, 0) == "k" && program.part(line, 1) == code;
+    }
+
+    // Directing the jumps to a jmp to the target of the jmp
+    bool thread_jumps(Program& program, PeepholeCounts& counts)
+    {
+        bool changed = false;
+        for (const CodeLine& line : program.lines)
+        {
+            if (line.count != 3 || program.part(line, 0) != "k" || !is_direct_jump(program.part(line, 1))) continue;
+            string_view target = program.part(line, 2);
+            // The chain of jmp is followed for at most the number of lines, a loop of jmp is left as it is
+            bool found = false;
+            for (size_t step = 0; step < program.lines.size() && !found; step++)
+            {
+                long address = name_address(program, target);
+                found = address < 0 || address % 2 != 0 || size_t(address / 2) >= program.lines.size();
+                if (found) break;
+                const CodeLine& next = program.lines[size_t(address / 2)];
+                found = !is_command(program, next, "1 0", 3) || program.part(next, 2) == target;
+                if (!found) target = program.part(next, 2);
+            }
+            if (found && target != program.part(line, 2))
+            {
+                program.parts[line.first + 2] = target;
+                counts.threaded_jumps++;
+                changed = true;
+            }
+        }
+        return changed;
+    }
+
+    // Marking the lines that do nothing
+    bool mark_removed(const Program& program, vector<bool>& removed, PeepholeCounts& counts)
+    {
+        bool changed = false;
+        size_t n = program.lines.size();
+        for (size_t i = 0; i < n; i++)
+        {
+            const CodeLine& line = program.lines[i];
+            if (is_command(program, line, "1 0", 3) && name_address(program, program.part(line, 2)) == long(2 * i + 2))
+                counts.jumps_to_next++;
+            else if (is_command(program, line, "23", 4) && i + 1 < n && is_command(program, program.lines[i + 1], "23", 4) &&
+                program.part(program.lines[i + 1], 2) == program.part(line, 2))
+                counts.replaced_loads++;
+            else if (is_command(program, line, "50", 4) && program.part(line, 2) == program.part(line, 3))
+                counts.loads_onto_itself++;
+            else continue;
+            removed[i] = true;
+            changed = true;
+        }
+        return changed;
+    }
+
+    string_view number_text(Program& program, long number)
+    {
+        char text[16];
+        std::to_chars_result result = std::to_chars(text, text + sizeof(text), number);
+        return program.store(string_view(text, size_t(result.ptr - text)));
+    }
+
+    // Removing the marked lines and moving the addresses after them
+    void remove_lines(Program& program, const vector<bool>& removed)
+    {
+        size_t n = program.lines.size();
+        vector<uint16_t> before(n + 1, 0); // Removed lines before a line
+        for (size_t i = 0; i < n; i++)
+            before[i + 1] = uint16_t(before[i] + (removed[i] ? 1 : 0));
+        // An address in a removed line goes to the next line
+        auto move = [&](uint16_t address) { return uint16_t(address - 2 * before[std::min(n, (size_t(address) + 1) / 2)]); };
+
+        for (auto& name : program.name_address)
+            name.second.address = move(name.second.address);
+        // The Jump over variables keeps its distance to the variables
+        for (assem::LocalAddress& local : program.local_addresses)
+        {
+            uint16_t address = move(local.address);
+            long value = std::atol(string(program.parts[local.part]).c_str());
+            program.parts[local.part] = number_text(program, value - (local.address - address));
+            local.address = address;
+        }
+        size_t kept = 0;
+        for (size_t i = 0; i < n; i++)
+        {
+            if (removed[i]) continue;
+            CodeLine line = program.lines[i];
+            // "0 start" of the end command
+            string_view code = line.count > 1 ? program.part(line, 1) : string_view();
+            if (program.part(line, 0) == "k" && code.size() > 2 && code[0] == '0' && code[1] == ' ')
+            {
+                uint16_t start = move(uint16_t(std::atol(string(code.substr(2)).c_str())));
+                program.parts[line.first + 1] = program.store("0 " + string(number_text(program, start)));
+            }
+            program.lines[kept++] = line;
+        }
+        program.lines.resize(kept);
+    }
+}
+
+// Peephole optimization after the first pass
+void assem::priv::optimize_program(Program& program) noexcept
+{
+    try
+    {
+        string reason = check_program(program);
+        if (!reason.empty())
+        {
+            std::cerr << "The program is not optimized: " << reason << ".\n";
+            return;
+        }
+        PeepholeCounts counts;
+        size_t lines = program.lines.size();
+        bool changed = true;
+        while (changed)
+        {
+            changed = thread_jumps(program, counts);
+            vector<bool> removed(program.lines.size(), false);
+            if (mark_removed(program, removed, counts))
+            {
+                remove_lines(program, removed);
+                changed = true;
+            }
+        }
+        // The report goes to stderr so that it does not mix with the program output
+        std::cerr << "Peephole optimization: " << lines - program.lines.size() << " instructions removed ("
+            << counts.jumps_to_next << " jumps to the next instruction, " << counts.replaced_loads
+            << " loads replaced by the next load, " << counts.loads_onto_itself << " loads onto themselves), "
+            << counts.threaded_jumps << " jumps threaded.\n";
+    }
+    catch (const std::exception& ex)
+    {
+        std::cerr << "The program is not optimized: " << ex.what() << ".\n";
+    }
+}
@@ -0,0 +1,626 @@
+#include "Relocatable.h"
+#include "image.h"
+#include <unordered_map>
+#include <charconv>
+#include <functional>
+#include <cctype>
+#include <algorithm>
+
+// The source is cut into blocks at the lines where no state of the first pass goes over:
+// before "proc" and after "endp", before a group of variables and after the line of code
+// that ends it. Every block is translated on its own from address 0 into a record that
+// does not depend on where the block is placed: the text and the image words of its lines
+// without the names, the fixups that say where the addresses of the names go, the names
+// defined in the block with their offsets and the number of cells the block takes. The
+// linker places the blocks one after another, gives the names their addresses and patches
+// the fixups, which replaces the second pass.
+//
+// A few rare programs depend on more than one block at once: a name that is also the
+// first part of a line ("k", "u", ...), a line whose first part is dropped after a type,
+// a name that is not a word. Their blocks cannot be linked.
+using namespace assem::reloc;
+using assem::Program;
+using assem::CodeLine;
+
+// Reading a record, false if it goes beyond the data
+bool assem::reloc::open_block(string_view record, Block& block) noexcept
+{
+    if (record.size() < sizeof(BlockHeader)) return false;
+    block.header = read_at<BlockHeader>(record.data());
+    const BlockHeader& h = block.header;
+    uint64_t size = sizeof(BlockHeader) + uint64_t(h.names) * sizeof(Name) + uint64_t(h.symbols) * sizeof(Symbol)
+        + (uint64_t(h.text_fixups) + h.word_fixups) * sizeof(Fixup) + uint64_t(h.words) * sizeof(uint32_t)
+        + h.text_size + h.pool_size;
+    if (h.size < size || h.size > record.size()) return false;
+    block.record = record.substr(0, h.size);
+    block.names = record.data() + sizeof(BlockHeader);
+    block.symbols = block.names + h.names * sizeof(Name);
+    block.text_fixups = block.symbols + h.symbols * sizeof(Symbol);
+    block.word_fixups = block.text_fixups + h.text_fixups * sizeof(Fixup);
+    block.words = block.word_fixups + h.word_fixups * sizeof(Fixup);
+    block.text = block.words + h.words * sizeof(uint32_t);
+    block.pool = block.text + h.text_size;
+    // A damaged record must not lead outside of itself
+    if (h.references > h.symbols) return false;
+    for (uint32_t i = 0; i < h.symbols; i++)
+    {
+        Symbol symbol = read_at<Symbol>(block.symbols, i);
+        if (uint64_t(symbol.offset) + symbol.size > h.pool_size) return false;
+    }
+    for (uint32_t i = 0; i < h.names; i++)
+        if (read_at<Name>(block.names, i).symbol >= h.symbols) return false;
+    uint32_t position = 0;
+    for (uint32_t i = 0; i < h.text_fixups + h.word_fixups; i++)
+    {
+        Fixup fixup = read_at<Fixup>(block.text_fixups, i);
+        bool text = i < h.text_fixups;
+        if (text && (fixup.position < position || fixup.position > h.text_size)) return false;
+        if (!text && fixup.position >= h.words) return false;
+        if ((fixup.source == NAME || fixup.source == EXPRESSION) && fixup.symbol >= h.references) return false;
+        position = text ? fixup.position : 0;
+    }
+    return true;
+}
+
+// Text of a symbol of the block
+string_view assem::reloc::symbol_text(const Block& block, uint32_t i) noexcept
+{
+    Symbol symbol = read_at<Symbol>(block.symbols, i);
+    return string_view(block.pool + symbol.offset, symbol.size);
+}
+
+// The hash of the standard library reads several bytes at a time. A cache written
+// by a build with another library only misses
+uint64_t assem::reloc::hash_text(string_view text) noexcept
+{
+    return std::hash<string_view>()(text);
+}
+
+namespace
+{
+    // Next line of the buffer with the line end. pos moves to the following line
+    string_view next_line(const char*& pos, const char* end) noexcept
+    {
+        const char* line_end = static_cast<const char*>(std::memchr(pos, '\n', size_t(end - pos)));
+        line_end = line_end == nullptr ? end : line_end + 1;
+        string_view line(pos, size_t(line_end - pos));
+        pos = line_end;
+        return line;
+    }
+
+    // First word of a line, split as parse_asm_line does
+    string_view first_word(string_view line) noexcept
+    {
+        size_t i = 0;
+        while (i < line.size() && (line[i] == ' ' || line[i] == '\t')) i++;
+        while (i < line.size() && (line[i] == ' ' || line[i] == ',')) i++;
+        size_t start = i;
+        while (i < line.size() && line[i] != ' ' && line[i] != ',' && line[i] != '\n') i++;
+        return line.substr(start, i - start);
+    }
+}
+
+// Cutting the source into blocks
+vector<string_view> assem::reloc::split_blocks(const string& source)
+{
+    vector<string_view> blocks;
+    const char* pos = source.data();
+    const char* end = pos + source.size();
+    const char* block_start = pos;
+    bool in_vars = false; // Inside a group of variables, which ends with the next line of code
+    auto cut = [&](const char* at)
+    {
+        if (at > block_start) blocks.push_back(string_view(block_start, size_t(at - block_start)));
+        block_start = at;
+    };
+    while (pos < end)
+    {
+        const char* line_start = pos;
+        string_view word = first_word(next_line(pos, end));
+        bool empty = word.empty() || word == "#" || word == "start";
+        // Types and their short forms begin with these letters
+        bool var = !empty && (word[0] == 'u' || word[0] == 'i' || word[0] == 'f');
+        if (var)
+        {
+            const assem::Keyword* keyword = assem::find_keyword(word);
+            var = assem::priv::is_var_type(keyword ? keyword->text : word);
+        }
+        if (in_vars)
+        {
+            if (!empty && !var)
+            {
+                in_vars = false;
+                cut(pos);
+            }
+        }
+        else if (var)
+        {
+            cut(line_start);
+            in_vars = true;
+        }
+        else if (word == "proc") cut(line_start);
+        else if (word == "endp") cut(pos);
+    }
+    cut(end);
+    return blocks;
+}
+
+namespace
+{
+    // Numbers of the lines are read as the image encoding does (Image.cpp)
+    int to_int(string_view text) { return std::stoi(string(text)); }
+
+    // Part of a line for the image: a number or a value placed by a fixup
+    struct Token
+    {
+        string_view text;
+        bool fixed; // Placed by a fixup
+        uint8_t source;
+        uint32_t symbol;
+        uint32_t addend;
+    };
+
+    // Address held by a part of the program, nullptr for the other parts
+    const assem::LocalAddress* local_address(const Program& program, uint32_t part) noexcept
+    {
+        auto found = std::lower_bound(program.local_addresses.begin(), program.local_addresses.end(), part,
+            [](const assem::LocalAddress& local, uint32_t i) { return local.part < i; });
+        return found != program.local_addresses.end() && found->part == part ? &*found : nullptr;
+    }
+
+    // Making the record of a block
+    class BlockBuilder
+    {
+    public:
+        // false with the reason in error if the block cannot be placed on its own
+        bool build(string_view source, uint64_t hash, string& record, string& error);
+
+    private:
+        uint32_t symbol(string_view name);
+        void add_part(string_view part, const assem::LocalAddress* local, bool expression);
+        bool add_word(const vector<Token>& tokens);
+        void add_fixup(vector<Fixup>& fixups, uint32_t position, const Token& token, uint8_t target, uint8_t shift, uint32_t mask);
+
+        vector<Name> names;
+        vector<Symbol> symbols;
+        std::unordered_map<string_view, uint32_t> symbol_index;
+        vector<Fixup> text_fixups, word_fixups;
+        vector<uint32_t> words;
+        string text, pool;
+        vector<Token> tokens;
+    };
+
+    uint32_t BlockBuilder::symbol(string_view name)
+    {
+        auto found = symbol_index.find(name);
+        if (found != symbol_index.end()) return found->second;
+        uint32_t i = uint32_t(symbols.size());
+        symbols.push_back(Symbol{ uint32_t(pool.size()), uint32_t(name.size()), hash_text(name) });
+        pool.append(name);
+        symbol_index.emplace(name, i);
+        return i;
+    }
+
+    void BlockBuilder::add_fixup(vector<Fixup>& fixups, uint32_t position, const Token& token, uint8_t target, uint8_t shift, uint32_t mask)
+    {
+        fixups.push_back(Fixup{ position, token.symbol, token.source, target, shift, 0, mask, token.addend });
+    }
+
+    // Part of a line after the first one: into the text and into the tokens of the word.
+    // A local part holds an address in the block, an expression part uses names
+    void BlockBuilder::add_part(string_view part, const assem::LocalAddress* local, bool expression)
+    {
+        if (local)
+        {
+            uint32_t value = uint32_t(std::atoi(string(part).c_str()));
+            Token token = { part, true, LOCAL, local->address, value - local->address };
+            add_fixup(text_fixups, uint32_t(text.size()), token, FIELD, 0, 0);
+            tokens.push_back(token);
+        }
+        else if (part.size() > 2 && part[0] == '0' && part[1] == ' ') // "0 start" of the end command
+        {
+            uint16_t start = uint16_t(std::atoi(string(part.substr(2)).c_str()));
+            Token token = { part, true, start == assem::priv::NO_START ? BLOCK_START : LOCAL, start, 0 };
+            text += "0 ";
+            add_fixup(text_fixups, uint32_t(text.size()), token, FIELD, 0, 0);
+            tokens.push_back(Token{ part.substr(0, 1), false, 0, 0, 0 });
+            tokens.push_back(token);
+        }
+        else if (expression)
+        {
+            Token token = { part, true, EXPRESSION, symbol(part), 0 };
+            add_fixup(text_fixups, uint32_t(text.size()), token, FIELD, 0, 0);
+            tokens.push_back(token);
+        }
+        else if (std::isalpha(static_cast<unsigned char>(part[0]))) // A name, or a word left as it is
+        {
+            Token token = { part, true, NAME, symbol(part), 0 };
+            add_fixup(text_fixups, uint32_t(text.size()), token, FIELD, 0, 0);
+            tokens.push_back(token);
+        }
+        else
+        {
+            text.append(part);
+            // A part can hold several numbers, they are split by the spaces as the loader does
+            size_t start = 0;
+            while (start < part.size())
+            {
+                size_t space = start;
+                while (space < part.size() && !std::isspace(static_cast<unsigned char>(part[space]))) space++;
+                if (space > start) tokens.push_back(Token{ part.substr(start, space - start), false, 0, 0, 0 });
+                start = space + 1;
+            }
+        }
+        text += ' ';
+    }
+
+    // Word of a line as encode_image makes it, with fixups for the placed values
+    bool BlockBuilder::add_word(const vector<Token>& tokens)
+    {
+        uint32_t position = uint32_t(words.size());
+        uint32_t word = 0;
+        string_view head = tokens[0].text;
+        if (head == "i" || head == "u" || head == "f")
+        {
+            if (tokens.size() >= 2 && tokens[1].fixed)
+                add_fixup(word_fixups, position, tokens[1], head == "f" ? FLOAT : INTEGER, 0, 0);
+            else if (tokens.size() >= 2 && head == "f")
+            {
+                float value = std::stof(string(tokens[1].text));
+                std::memcpy(&word, &value, sizeof(word));
+            }
+            else if (tokens.size() >= 2) word = uint32_t(std::stoll(string(tokens[1].text)));
+        }
+        else // Command: the code and the fields of the operands as in command_word
+        {
+            if (tokens.size() < 2 || tokens[1].fixed) return false;
+            uint32_t code = to_int(tokens[1].text) & 0xFF;
+            word = code;
+            size_t n = tokens.size();
+            for (size_t i = 2; i < n && i < 5; i++)
+            {
+                uint8_t shift;
+                uint32_t mask;
+                if (n == 3) { shift = code == 51 ? 16 : 24; mask = code == 51 ? 0xFFFF : 0xFF; }
+                else if (n == 4) { shift = i == 2 ? 8 : 16; mask = i == 2 ? 0xFF : 0xFFFF; }
+                else { shift = uint8_t(8 * (i - 1)); mask = 0xFF; }
+                if (tokens[i].fixed) add_fixup(word_fixups, position, tokens[i], FIELD, shift, mask);
+                else word |= uint32_t(to_int(tokens[i].text) & mask) << shift;
+            }
+        }
+        words.push_back(word);
+        return true;
+    }
+
+    bool BlockBuilder::build(string_view source, uint64_t hash, string& record, string& error)
+    {
+        Program program;
+        BlockHeader header = BlockHeader();
+        header.hash = hash;
+        assem::priv::translate_block(source, program, header.advance, header.start);
+
+        string_view prev = "";
+        try
+        {
+            for (const CodeLine& line : program.lines)
+            {
+                tokens.clear();
+                bool head = true;
+                for (uint32_t i = 0; i < line.count; i++)
+                {
+                    string_view part = program.part(line, i);
+                    if (!assem::priv::is_var_type(prev))
+                    {
+                        if (!head)
+                            add_part(part, local_address(program, line.first + i),
+                                std::binary_search(program.expressions.begin(), program.expressions.end(), line.first + i));
+                        else if (part == "k" || assem::priv::is_var_type(part))
+                        {
+                            text.append(part);
+                            text += ' ';
+                            tokens.push_back(Token{ part, false, 0, 0, 0 });
+                            head = false;
+                        }
+                        else // The line does not start as usual, it depends on the lines before
+                        {
+                            error = "a line of the block beginning with \"" + string(source.substr(0, source.find('\n'))) +
+                                "\" depends on the line before it";
+                            return false;
+                        }
+                    }
+                    prev = part;
+                }
+                text += '\n';
+                if (!tokens.empty() && !add_word(tokens))
+                {
+                    error = "a command without a code";
+                    return false;
+                }
+            }
+        }
+        catch (const std::exception& ex)
+        {
+            error = string("failed to encode the image: ") + ex.what();
+            return false;
+        }
+        if (assem::priv::is_var_type(prev)) header.flags |= ENDS_WITH_TYPE;
+
+        header.references = uint32_t(symbols.size());
+        for (const auto& name : program.name_address)
+        {
+            if (!std::isalpha(static_cast<unsigned char>(name.first[0])))
+            {
+                error = "the name \"" + string(name.first) + "\" does not begin with a letter";
+                return false;
+            }
+            names.push_back(Name{ symbol(name.first), name.second.address });
+        }
+
+        header.names = uint32_t(names.size());
+        header.symbols = uint32_t(symbols.size());
+        header.text_fixups = uint32_t(text_fixups.size());
+        header.word_fixups = uint32_t(word_fixups.size());
+        header.words = uint32_t(words.size());
+        header.text_size = uint32_t(text.size());
+        header.pool_size = uint32_t(pool.size());
+        size_t size = sizeof(header) + names.size() * sizeof(Name) + symbols.size() * sizeof(Symbol)
+            + (text_fixups.size() + word_fixups.size()) * sizeof(Fixup) + words.size() * sizeof(uint32_t)
+            + text.size() + pool.size();
+        header.size = uint32_t((size + 7) & ~size_t(7)); // Records are kept 8-byte aligned
+
+        size_t offset = record.size();
+        record.reserve(offset + header.size);
+        record.append(reinterpret_cast<const char*>(&header), sizeof(header));
+        record.append(reinterpret_cast<const char*>(names.data()), names.size() * sizeof(Name));
+        record.append(reinterpret_cast<const char*>(symbols.data()), symbols.size() * sizeof(Symbol));
+        record.append(reinterpret_cast<const char*>(text_fixups.data()), text_fixups.size() * sizeof(Fixup));
+        record.append(reinterpret_cast<const char*>(word_fixups.data()), word_fixups.size() * sizeof(Fixup));
+        record.append(reinterpret_cast<const char*>(words.data()), words.size() * sizeof(uint32_t));
+        record.append(text);
+        record.append(pool);
+        record.resize(offset + header.size, '\0');
+        return true;
+    }
+
+    // Addresses of the names of the program. The table is open and keeps the hashes
+    // of the symbols in the slots, so a search mostly reads one slot
+    class NameTable
+    {
+    public:
+        explicit NameTable(size_t count)
+        {
+            size_t size = 16;
+            while (size < 2 * count) size *= 2;
+            slots.resize(size);
+            mask = size - 1;
+        }
+
+        void set(const Block& block, uint32_t symbol, uint32_t address) noexcept
+        {
+            Symbol found = read_at<Symbol>(block.symbols, symbol);
+            Slot& slot = place(string_view(block.pool + found.offset, found.size), found.hash);
+            slot.address = address;
+        }
+
+        uint32_t get(const Block& block, uint32_t symbol) const noexcept
+        {
+            Symbol found = read_at<Symbol>(block.symbols, symbol);
+            return get(string_view(block.pool + found.offset, found.size), found.hash);
+        }
+
+        uint32_t get(string_view name, uint64_t hash) const noexcept
+        {
+            for (size_t i = size_t(hash) & mask; ; i = (i + 1) & mask)
+            {
+                const Slot& slot = slots[i];
+                if (slot.name == nullptr) return NO_ADDRESS;
+                if (slot.hash == hash && string_view(slot.name, slot.size) == name) return slot.address;
+            }
+        }
+
+    private:
+        struct Slot
+        {
+            uint64_t hash;
+            const char* name = nullptr;
+            uint32_t size;
+            uint32_t address;
+        };
+
+        Slot& place(string_view name, uint64_t hash) noexcept
+        {
+            for (size_t i = size_t(hash) & mask; ; i = (i + 1) & mask)
+            {
+                Slot& slot = slots[i];
+                if (slot.name == nullptr)
+                {
+                    slot.hash = hash;
+                    slot.name = name.data();
+                    slot.size = uint32_t(name.size());
+                    return slot;
+                }
+                if (slot.hash == hash && string_view(slot.name, slot.size) == name) return slot;
+            }
+        }
+
+        vector<Slot> slots;
+        size_t mask;
+    };
+}
+
+// Translating a block and adding its record to the end of record
+bool assem::reloc::build_block(string_view source, uint64_t hash, string& record, string& error)
+{
+    return BlockBuilder().build(source, hash, record, error);
+}
+
+// Placing the blocks one after another and patching the fixups
+bool assem::reloc::link_blocks(const vector<Block>& blocks, bool need_text, string& text, string& image, string& error)
+{
+    // Addresses of the blocks and of the names. A later definition replaces the earlier one
+    vector<uint16_t> bases(blocks.size()), starts(blocks.size());
+    size_t name_count = 0, symbol_count = 0, text_size = 0, fixup_count = 0, word_count = 0;
+    for (const Block& block : blocks)
+    {
+        name_count += block.header.names;
+        symbol_count += block.header.references;
+        text_size += block.header.text_size;
+        fixup_count += block.header.text_fixups;
+        word_count += block.header.words;
+    }
+    NameTable addresses(name_count);
+    uint16_t address = 0, start = 0;
+    for (size_t b = 0; b < blocks.size(); b++)
+    {
+        const Block& block = blocks[b];
+        if ((block.header.flags & ENDS_WITH_TYPE) && b + 1 < blocks.size())
+        {
+            error = "a block ends with a type, which drops the first part of the next block";
+            return false;
+        }
+        bases[b] = address;
+        starts[b] = start;
+        for (uint32_t i = 0; i < block.header.names; i++)
+        {
+            Name name = read_at<Name>(block.names, i);
+            addresses.set(block, name.symbol, uint16_t(address + name.address));
+        }
+        if (block.header.start != assem::priv::NO_START) start = uint16_t(address + block.header.start);
+        address = uint16_t(address + block.header.advance);
+    }
+    // A name equal to the first part of a line changes the kind of the line
+    for (string_view head : { "k", "i", "u", "f" })
+        if (addresses.get(head, hash_text(head)) != NO_ADDRESS)
+        {
+            error = "the name \"" + string(head) + "\" is the first part of the lines";
+            return false;
+        }
+
+    // Addresses of the symbols of every block, NO_ADDRESS for the words that are not names
+    vector<uint32_t> resolved, first_symbol(blocks.size());
+    resolved.reserve(symbol_count);
+    for (size_t b = 0; b < blocks.size(); b++)
+    {
+        first_symbol[b] = uint32_t(resolved.size());
+        for (uint32_t i = 0; i < blocks[b].header.references; i++)
+        {
+            resolved.push_back(addresses.get(blocks[b], i));
+        }
+    }
+
+    // Expressions are solved with the addresses of the names. An expression that is a name is its address.
+    // An expression that cannot be solved stops the linking with the reason in error
+    IntExprSolver solver;
+    bool unsolved = false;
+    IntExprSolver::NameValue name_value = [&addresses](string_view name, int& number)
+    {
+        uint32_t address = addresses.get(name, hash_text(name));
+        number = int(address);
+        return address != NO_ADDRESS;
+    };
+    auto value = [&](size_t b, const Fixup& fixup)
+    {
+        if (fixup.source == BLOCK_START) return uint32_t(starts[b]);
+        if (fixup.source == LOCAL) return uint16_t(bases[b] + fixup.symbol) + fixup.addend;
+        uint32_t address = resolved[first_symbol[b] + fixup.symbol];
+        if (fixup.source == EXPRESSION && address == NO_ADDRESS)
+        {
+            string_view expr = symbol_text(blocks[b], fixup.symbol);
+            try
+            {
+                return uint32_t(solver.evaluate(expr, &name_value));
+            }
+            catch (const std::exception& ex)
+            {
+                error = "the expression \"" + string(expr) + "\": " + ex.what();
+                unsolved = true;
+            }
+        }
+        return address;
+    };
+
+    // Text: the pieces between the fixups, the addresses or the words without an address
+    if (need_text)
+    {
+        text.clear();
+        text.reserve(text_size + fixup_count * 6);
+        for (size_t b = 0; b < blocks.size(); b++)
+        {
+            const Block& block = blocks[b];
+            uint32_t done = 0;
+            for (uint32_t i = 0; i < block.header.text_fixups; i++)
+            {
+                Fixup fixup = read_at<Fixup>(block.text_fixups, i);
+                text.append(block.text + done, fixup.position - done);
+                done = fixup.position;
+                uint32_t number = value(b, fixup);
+                if (unsolved) return false;
+                if (number != NO_ADDRESS || fixup.source == EXPRESSION)
+                {
+                    // The value of an expression is written as a signed number, as the translation does
+                    char digits[16];
+                    std::to_chars_result result = fixup.source == EXPRESSION ?
+                        std::to_chars(digits, digits + sizeof(digits), int32_t(number)) :
+                        std::to_chars(digits, digits + sizeof(digits), number);
+                    text.append(digits, size_t(result.ptr - digits));
+                }
+                else text.append(symbol_text(block, fixup.symbol));
+            }
+            text.append(block.text + done, block.header.text_size - done);
+        }
+    }
+
+    // Image: one segment with the words of all blocks
+    ImageHeader header;
+    std::memcpy(header.magic, "VM9I", 4);
+    header.version = IMAGE_VERSION;
+    header.segments = word_count > 0 ? 1 : 0;
+    header.entry = 0;
+    header.reserved = 0;
+    image.clear();
+    image.reserve(sizeof(header) + sizeof(ImageSegment) + word_count * sizeof(uint32_t));
+    image.append(reinterpret_cast<const char*>(&header), sizeof(header));
+    if (word_count == 0) return true;
+    ImageSegment segment = { 0, uint16_t(word_count) };
+    image.append(reinterpret_cast<const char*>(&segment), sizeof(segment));
+    for (size_t b = 0; b < blocks.size(); b++)
+    {
+        const Block& block = blocks[b];
+        size_t block_words = image.size();
+        image.append(block.words, block.header.words * sizeof(uint32_t));
+        for (uint32_t i = 0; i < block.header.word_fixups; i++)
+        {
+            Fixup fixup = read_at<Fixup>(block.word_fixups, i);
+            uint32_t number = value(b, fixup);
+            if (unsolved) return false;
+            if (number == NO_ADDRESS && fixup.source != EXPRESSION)
+            {
+                error = "unknown name \"" + string(symbol_text(block, fixup.symbol)) + "\"";
+                return false;
+            }
+            char* pos = &image[block_words + fixup.position * sizeof(uint32_t)];
+            uint32_t word = read_at<uint32_t>(pos);
+            if (fixup.target == FIELD) word = (word & ~(fixup.mask << fixup.shift)) | (number & fixup.mask) << fixup.shift;
+            else if (fixup.target == INTEGER) word = number;
+            else
+            {
+                float fraction = float(int32_t(number));
+                std::memcpy(&word, &fraction, sizeof(word));
+            }
+            std::memcpy(pos, &word, sizeof(word));
+        }
+    }
+    return true;
+}
+
+bool assem::reloc::write_file(const string& file_path, const string& data, bool binary) noexcept
+{
+    std::ofstream fout(file_path, binary ? std::ios::out | std::ios::trunc | std::ios::binary : std::ios::out | std::ios::trunc);
+    if (!fout)
+    {
+        std::cout << "Failed to open file \"" << file_path << "\" for writing.\n";
+        return false;
+    }
+    fout.write(data.data(), std::streamsize(data.size()));
+    return bool(fout);
+}
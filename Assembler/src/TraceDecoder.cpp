@@ -0,0 +1,83 @@
+#include "Assembler.h"
+#include <iostream>
+#include <iomanip>
+#include <cstring>
+#include <cstdint>
+
+// Trace file of the virtual machine (VirtualMachine/include/trace.h):
+// the header, then the records from the oldest one, in the byte order of the machine
+namespace
+{
+    struct TraceRecord
+    {
+        uint16_t ip;
+        uint16_t flags;
+        uint32_t word;
+        uint16_t operands[3];
+        uint16_t reserved;
+    };
+
+    struct TraceHeader
+    {
+        char magic[4];
+        uint16_t version;
+        uint16_t record_size;
+        uint64_t records;
+        uint64_t executed;
+    };
+
+    constexpr int LOAD_CODE = 23, CALL_CODE = 51;
+}
+
+// Printing the execution trace written by the virtual machine
+bool assem::print_trace(const string& trace_file_path, std::ostream& out) noexcept
+{
+    std::ifstream fin(trace_file_path, std::ios::binary);
+    if (!fin)
+    {
+        std::cout << "Failed to open file \"" << trace_file_path << "\" for reading.\n";
+        return false;
+    }
+
+    TraceHeader header;
+    if (!fin.read(reinterpret_cast<char*>(&header), sizeof(header)) || std::memcmp(header.magic, "VM9T", 4) != 0
+        || header.version != 1 || header.record_size != sizeof(TraceRecord))
+    {
+        std::cout << "\"" << trace_file_path << "\" is not a trace of the virtual machine.\n";
+        return false;
+    }
+
+    // Names of the codes from the table of the assembler
+    vector<string> mnemonics(256, "?");
+    for (const Keyword& keyword : keywords)
+        if (keyword.code >= 0) mnemonics[keyword.code] = string(keyword.name);
+
+    out << "Instructions executed: " << header.executed << ", last " << header.records << ":\n";
+    uint64_t number = header.executed - header.records;
+    TraceRecord rec;
+    while (fin.read(reinterpret_cast<char*>(&rec), sizeof(rec)))
+    {
+        int code = rec.word & 0xFF;
+        int reg = (rec.word >> 8) & 0xFF;
+        out << std::setw(12) << number++ << std::setw(8) << rec.ip << "  " << std::left << std::setw(8)
+            << mnemonics[code] << std::right;
+        uint16_t address = rec.word >> 16;
+        if (code >= 1 && code <= 19) // Jumps keep the way of finding the target instead of a register
+            out << address << (reg != 0 ? " (type " + std::to_string(reg) + ')' : "");
+        else if (code == LOAD_CODE)
+            out << 'r' << reg << ", " << address;
+        else if (code == CALL_CODE)
+            out << address;
+        else
+        {
+            for (int i = 0; i < 3; i++)
+            {
+                int operand = (rec.word >> (8 * (i + 1))) & 0xFF;
+                out << (i > 0 ? ", r" : "r") << operand << '[' << rec.operands[i] << ']';
+            }
+        }
+        out << "  flags " << std::hex << std::setw(4) << std::setfill('0') << rec.flags
+            << std::dec << std::setfill(' ') << '\n';
+    }
+    return true;
+}
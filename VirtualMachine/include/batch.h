@@ -0,0 +1,31 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <string>
+#include <vector>
+#include <functional>
+#include "processor.h"
+
+// Program run by the batch executor
+struct BatchJob
+{
+    std::string program;     // File with the generated code
+    std::string input;       // File for the read commands (empty - no input)
+    std::string output_path; // File for the output (empty - the output is only kept in output)
+    std::string output;      // Output of the program
+    bool loaded = false;     // Was the code file loaded
+};
+
+// Reading the list of jobs. A line holds the code file and, optionally,
+// the input and the output files. Text after # is a comment
+bool read_batch_list(const char* filename, std::vector<BatchJob>& jobs);
+
+// Running the jobs on worker threads with processors reused through a ProcessorPool.
+// The configure function sets up every processor (dispatch, fusion and so on)
+void run_batch(std::vector<BatchJob>& jobs, unsigned workers, const std::function<void(Processor&)>& configure);
+
+// Measuring the time per job of running the program the given number of times
+// on new processors and on processors reused through a pool (printed to stdout)
+void bench_startup(const char* program, unsigned runs, const std::function<void(Processor&)>& configure);
+
+#endif // BATCH_H
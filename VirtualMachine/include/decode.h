@@ -0,0 +1,118 @@
+#ifndef DECODE_H
+#define DECODE_H
+
+#include "types.h"
+#include "flow.h"
+
+// Operation codes of instruction pairs executed as one (superinstructions)
+enum FusedOpcode : uint8_t
+{
+    OP_CMP_JUMP = OP_AMOUNT, // cmp + signed conditional jump
+    OP_CMPU_JUMP,            // cmpu + unsigned conditional jump
+    OP_CMPF_JUMP,            // cmpf + fractional conditional jump
+    OP_INC_JMP,              // inc + unconditional jump
+
+    // Instructions whose flag updates are never read (see FlagLiveness)
+    OP_ADD_NOFLAGS, OP_SUB_NOFLAGS, OP_MUL_NOFLAGS, OP_ADDF_NOFLAGS, OP_SUBF_NOFLAGS, OP_MULF_NOFLAGS,
+    OP_AND_NOFLAGS, OP_OR_NOFLAGS, OP_XOR_NOFLAGS, OP_NOT_NOFLAGS, OP_INC_NOFLAGS, OP_DEC_NOFLAGS,
+    OP_CMP_JUMP_NOFLAGS, OP_CMPU_JUMP_NOFLAGS, OP_CMPF_JUMP_NOFLAGS, OP_INC_JMP_NOFLAGS,
+    OP_SKIP,                 // Comparison whose result is never read
+
+    OP_DECODED_AMOUNT        // Number of operation codes in decoded records
+};
+
+// Instruction with its fields already extracted from the word
+struct DecodedCmd
+{
+    const void* handler; // Label of the instruction in the threaded run loop
+    uint8_t cmd;         // Operation code (NOT_DECODED for an empty record)
+    uint8_t regs[3];     // Registers. For jumps regs[0] == 0 means that target is already calculated.
+                         // For compare-and-jump regs[2] holds the jump condition (see jump_mask)
+    uint16_t adrs;       // Address (constant) in the command
+    uint16_t target;     // Jump or call address calculated when decoding
+};
+
+// Index of the jump_mask bit for a comparison result
+inline int jump_mask_bit(bool equal, bool greater) noexcept
+{
+    return (equal << 1) | greater;
+}
+
+// Pre-decoded instructions indexed by the Instruction Pointer.
+// A record is filled the first time its instruction is executed and
+// emptied again when the memory under it is written.
+class DecodeCache final
+{
+public:
+    static constexpr uint32_t SIZE = 65536; // The whole 16-bit address space
+    static constexpr uint8_t NOT_DECODED = 0xFF;
+
+    DecodeCache() = default;
+    ~DecodeCache();
+    DecodeCache(const DecodeCache&) = delete;
+    DecodeCache& operator=(const DecodeCache&) = delete;
+
+    // Preparing the records for a run loop with the given decoding label
+    void attach(const void* decoder);
+
+    // Emptying all records
+    void clear() noexcept;
+
+    // Decoding a word into the record at the address. The following word (next) is
+    // used to fuse instruction pairs. Labels are indexed by the operation code.
+    DecodedCmd& decode(uint16_t address, Word word, Word next, void* const* labels) noexcept;
+
+    // Turning the fusion of instruction pairs on or off
+    void set_fusion(bool enabled);
+
+    // Finding the flag updates that are never read in the program starting at the address
+    // and emptying the records. Returns the number of instructions with such updates
+    uint32_t analyze_flags(const Memory& memory, uint16_t start);
+
+    // Turning the use of the flag analysis on or off
+    void set_flag_analysis(bool enabled);
+
+    DecodedCmd& operator[](uint16_t address) noexcept { return records[address]; }
+
+    // Emptying the records of the instructions that overlap a word written at the address.
+    // A fused record covers two words, so it starts up to 3 cells before the address.
+    void invalidate(uint16_t address) noexcept
+    {
+        if (records == nullptr) return;
+        if (liveness.covers(address) || liveness.covers(uint16_t(address + 1)))
+            drop_flag_analysis();
+        forget(uint16_t(address - 3), true);
+        forget(uint16_t(address - 2), true);
+        forget(uint16_t(address - 1), false);
+        forget(address, false);
+        forget(uint16_t(address + 1), false);
+    }
+
+    bool code_written = false; // A decoded instruction was overwritten since the flag was reset
+
+private:
+    DecodedCmd* records = nullptr;
+    const void* decoder = nullptr; // Handler of an empty record
+    uint64_t used_pages = 0; // 1024-record pages with decoded records
+    bool fusion = true; // Are instruction pairs fused
+    bool flag_analysis = true; // Are the flag updates that are never read skipped
+    FlagLiveness liveness;
+
+    // The analysed code has changed: the records decoded with the analysis are emptied
+    void drop_flag_analysis() noexcept;
+
+    void forget(uint16_t address, bool only_fused) noexcept
+    {
+        uint8_t cmd = records[address].cmd;
+        bool fused = (cmd >= OP_CMP_JUMP && cmd <= OP_INC_JMP) ||
+                     (cmd >= OP_CMP_JUMP_NOFLAGS && cmd <= OP_INC_JMP_NOFLAGS);
+        if (cmd != NOT_DECODED && (!only_fused || fused))
+        {
+            code_written = true;
+            records[address].cmd = NOT_DECODED;
+            records[address].handler = decoder;
+        }
+    }
+};
+
+#endif // DECODE_H
@@ -0,0 +1,49 @@
+#ifndef FLOW_H
+#define FLOW_H
+
+#include "types.h"
+#include <vector>
+
+class Memory;
+
+// Liveness of the status flags over the control flow graph of a program (see flow.cpp).
+// For every instruction reachable from the start it finds the flags that can be read
+// after it before being overwritten. The threaded run loop executes instructions
+// whose flag updates are never read by variants that do not update the flags.
+class FlagLiveness final
+{
+public:
+    static constexpr uint32_t SIZE = 65536; // The whole 16-bit address space
+    static constexpr uint16_t ALL_FLAGS = 0xFFFF;
+
+    FlagLiveness() = default;
+    ~FlagLiveness();
+    FlagLiveness(const FlagLiveness&) = delete;
+    FlagLiveness& operator=(const FlagLiveness&) = delete;
+
+    // Analysing the program in the memory that starts at the address.
+    // Returns the number of instructions whose flag updates are never read
+    uint32_t analyze(const Memory& memory, uint16_t start);
+
+    // Forgetting the results when the analysed code is changed
+    void discard() noexcept;
+
+    // Does the cell hold an analysed instruction
+    bool covers(uint16_t address) const noexcept { return active && code[address]; }
+
+    // Flags that can be read after the instruction at the address
+    uint16_t live_after(uint16_t address) const noexcept { return active ? live_out[address] : ALL_FLAGS; }
+
+    // Flags written and read by an instruction
+    static uint16_t written(Word word) noexcept;
+    static uint16_t read(Word word) noexcept;
+
+private:
+    bool active = false;
+    uint16_t* live_out = nullptr; // Flags live after every instruction
+    uint8_t* code = nullptr;      // 1 for the cells of the analysed instructions
+    int32_t* index = nullptr;     // Node of the control flow graph at every address (-1 if none)
+    std::vector<uint16_t> analysed; // Addresses of the analysed instructions
+};
+
+#endif // FLOW_H
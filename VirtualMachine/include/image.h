@@ -0,0 +1,41 @@
+#ifndef IMAGE_H
+#define IMAGE_H
+
+#include "types.h"
+
+class Processor;
+
+// Binary program image written by the assembler (Assembler/src/Image.cpp).
+// The header is followed by the segments, a segment header by its words.
+// Every field is in the byte order of the machine.
+struct ImageHeader
+{
+    char magic[4];     // "VM9I"
+    uint16_t version;
+    uint16_t segments; // Number of segments
+    uint16_t entry;    // Address the program starts from
+    uint16_t reserved;
+};
+
+// Words loaded to the consecutive addresses (as after the "a" line of the text format)
+struct ImageSegment
+{
+    uint16_t address;
+    uint16_t words;
+};
+
+static_assert(sizeof(ImageHeader) == 12 && sizeof(ImageSegment) == 4, "The image is read as it is kept");
+
+enum class ImageStatus
+{
+    NotImage, // The file is not an image (it can be the text format)
+    Loaded,
+    Invalid   // The image is damaged
+};
+
+constexpr uint16_t IMAGE_VERSION = 1;
+
+// Checking the image in the file contents and copying its segments into memory
+ImageStatus load_image(Processor& cpu, const char* data, size_t size, uint16_t& run_address) noexcept;
+
+#endif // IMAGE_H
@@ -0,0 +1,68 @@
+#ifndef INPUT_H
+#define INPUT_H
+
+#include "types.h"
+#include "mapped.h"
+
+class OutputChannel;
+
+// Source of the values of the read commands (see input.cpp).
+// By default the values are extracted from a stream one at a time, which works
+// with a terminal. In the bulk modes the whole input is in memory (a mapped file
+// or the slurped standard input) and is parsed without the streams: as text with
+// the same results as the stream extraction, or as raw 32-bit words.
+class InputChannel final
+{
+public:
+    enum class Mode : uint8_t
+    {
+        Stream, // Formatted extraction from the stream
+        Text,   // Numbers in the text in memory
+        Binary  // 32-bit words in the byte order of the machine
+    };
+
+    InputChannel() = default;
+    ~InputChannel();
+    InputChannel(const InputChannel&) = delete;
+    InputChannel& operator=(const InputChannel&) = delete;
+
+    // Stream of the stream mode
+    void set_stream(std::istream* stream) noexcept { source = stream; }
+
+    // Output written before every read from the stream, as std::istream::tie does
+    void tie(OutputChannel* output) noexcept { tied = output; }
+
+    // Taking the whole file ("-" - the standard input) as the input in the text or the
+    // binary mode. Returns false if the file cannot be read
+    bool open(const char* path, Mode bulk_mode);
+
+    // Returning to the stream mode
+    void close() noexcept;
+
+    Mode get_mode() const noexcept { return mode; }
+
+    // Reading the next value. After a failed read every value is zero, as after the failed
+    // extraction from a stream (whose result is zero too)
+    int32_t read_int() noexcept;
+    uint32_t read_uint() noexcept;
+    float read_float() noexcept;
+
+private:
+    Mode mode = Mode::Stream;
+    std::istream* source = &std::cin;
+    OutputChannel* tied = nullptr;
+
+    MappedFile file;            // Input of the bulk modes
+    const char* pos = nullptr;  // Next character
+    const char* end = nullptr;
+    bool failed = false;
+
+    // Skipping the spaces and the sign. Returns false if the input has failed or ended
+    bool start_number(bool& negative) noexcept;
+    // Reading the sign and the digits of an integer
+    bool read_integer(bool& negative, uint64_t& magnitude) noexcept;
+    // Next raw word of the binary mode
+    uint32_t next_word() noexcept;
+};
+
+#endif // INPUT_H
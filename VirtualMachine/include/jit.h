@@ -0,0 +1,75 @@
+#ifndef JIT_H
+#define JIT_H
+
+#include "types.h"
+
+class Processor;
+
+// Compiler of hot basic blocks into x86-64 code (see jit.cpp).
+// A block starts at a jump target or after an instruction that is not compiled,
+// and ends with a jump, call or return from a subroutine. Instructions without
+// native code are executed in the block by calling their Command objects.
+// The end and read instructions are left to the interpreter.
+class Jit final
+{
+public:
+    static constexpr uint16_t DEFAULT_THRESHOLD = 50; // Entries after which a block is compiled
+    static constexpr int MAX_BLOCK_COMMANDS = 64;
+    static constexpr uint32_t CODE_SIZE = 4 << 20; // Executable memory for the compiled blocks
+
+    // Pointers that the compiled code keeps in registers
+    struct Context
+    {
+        uint16_t* regs;      // Address registers
+        uint16_t* cells;     // Memory cells
+        uint16_t* flags;     // Status flags
+        Processor* proc;
+        uint8_t* code_cells; // Cells holding compiled instructions
+    };
+
+    // Compiled block. Returns the Instruction Pointer to continue from
+    using Block = uint32_t (*)(Context* ctx);
+
+    Jit() = default;
+    ~Jit();
+    Jit(const Jit&) = delete;
+    Jit& operator=(const Jit&) = delete;
+
+    // Can the JIT work on this platform
+    static bool supported() noexcept;
+
+    void set_threshold(uint16_t executions) noexcept;
+
+    // Allocating the tables and executable memory for the processor
+    bool prepare(Processor& proc);
+
+    // Compiled block starting at the address or nullptr
+    Block find(uint16_t address) const noexcept { return blocks[address]; }
+
+    // Counting an entry to the address. True when the block has become hot
+    bool hot(uint16_t address) noexcept;
+
+    // Compiling the block starting at the address
+    bool compile(uint16_t address);
+
+    // Discarding all compiled blocks
+    void flush() noexcept;
+
+    Context context = Context();
+
+private:
+    static constexpr uint16_t NEVER = 0xFFFF; // Counter of an address that cannot start a block
+
+    uint16_t threshold = DEFAULT_THRESHOLD;
+    Processor* proc = nullptr;
+    Block* blocks = nullptr;       // Compiled blocks indexed by the start address
+    uint16_t* counters = nullptr;  // Entries to every address
+    uint8_t* code_cells = nullptr; // 1 for the cells of compiled instructions
+    uint8_t* code = nullptr;       // Executable memory
+    uint32_t code_used = 0;
+    uint64_t used_pages = 0; // 1024-address pages of the tables that are not empty
+
+    static uint64_t page_bit(uint16_t address) noexcept { return uint64_t(1) << (address >> 10); }
+};
+
+#endif // JIT_H
@@ -7,19 +7,24 @@
 #include <vector>
 #include "processor.h"
 
-// Splitting a string into pieces separated by a space
-std::vector<std::string> split(const std::string& line) noexcept;
+// Result of loading a program
+enum class LoadStatus
+{
+    Loaded,
+    NotOpened, // The file cannot be opened
+    Malformed  // Some lines (or the image) are wrong, they are reported to the output of the processor
+};
 
-// Parsing a string with memory allocation for a variable
-void parse_variable(std::vector<std::string>& parts, uint16_t adrs, Processor& cpu) noexcept;
-
-// Parsing strings with command
-Word parse_command(std::vector<std::string>& parts, Processor& cpu) noexcept;
-
-// Parsing all strings
-bool parse_line_parts(std::vector<std::string>& parts, uint16_t address, Processor& cpu) noexcept;
+// Loading commands and variables from a file (a binary image or the text format)
+// into memory without running them. A large text file is parsed in parts on the given
+// number of threads
+LoadStatus load_program(Processor& cpu, const char* filename, uint16_t& run_address, unsigned threads = 1) noexcept;
 
 // Function that implements the bootloader
-void load(Processor& cpu, char* filename) noexcept;
+void load(Processor& cpu, char* filename, unsigned threads = 1) noexcept;
+
+// Measuring the loading speed of a generated text file with the given number of lines
+// on one thread and on the given number of threads
+void bench_loader(unsigned lines, unsigned threads);
 
 #endif // LOADER_H
@@ -0,0 +1,34 @@
+#ifndef MAPPED_H
+#define MAPPED_H
+
+#include <cstddef>
+#include <iosfwd>
+
+// Contents of a whole file in memory (see mapped.cpp).
+// A regular file is mapped, other files and streams are read into a buffer
+class MappedFile final
+{
+public:
+    MappedFile() = default;
+    ~MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // Taking the file. Returns false if it cannot be read
+    bool open(const char* path);
+
+    // Reading the stream to its end
+    void read(std::istream& stream);
+
+    void close() noexcept;
+
+    const char* data() const noexcept { return bytes; }
+    size_t size() const noexcept { return length; }
+
+private:
+    const char* bytes = nullptr;
+    size_t length = 0;
+    bool mapped = false; // Is the file mapped (otherwise the bytes are allocated)
+};
+
+#endif // MAPPED_H
@@ -2,19 +2,28 @@
 #define MEMORY_H
 
 #include "types.h"
+#include "decode.h"
 #include <iostream>
 #include <bitset>
 
 // According to the laboratory work assignment option:
 // Word - 32 bit
 // Memory cell size - 16 bits
+// The cells are kept in pairs as 32-bit words, so a word at an even address
+// (every instruction and variable of the assembler) is a single load or store.
+// Writes mark their pages as dirty, and clearing zeroes only the dirty pages.
 class Memory final
 {
 public:
     static constexpr uint32_t MEM_SIZE = 32768;
+    static constexpr uint32_t PAGE_BITS = 9; // Page of 512 cells
+    static constexpr uint32_t PAGES = MEM_SIZE >> PAGE_BITS;
+    static_assert(PAGES <= 64, "Dirty pages are kept in a 64-bit mask");
 
     Memory();
     ~Memory();
+    Memory(const Memory&) = delete;
+    Memory& operator=(const Memory&) = delete;
 
     void clear();
 
@@ -22,14 +31,60 @@ public:
     void set_word(uint16_t address, Word word);
     void set_word(uint16_t address, uint16_t word_part1, uint16_t word_part2);
 
+    // Copying words to the consecutive addresses (loading of program images).
+    // The words must fit into the memory
+    void load_words(uint16_t address, const Word* words, uint32_t count);
+
     // Getting a word in memory by address
     Word get_word(uint16_t address) const noexcept;
 
+    // Getting a memory cell by address
+    uint16_t get_cell(uint16_t address) const noexcept;
+
     // Displaying the values ​​of memory cells
     void print_memory(uint16_t first, uint16_t last) const noexcept;
 
+    // Direct access to the memory cells (for the compiled code).
+    // These writes are not tracked, so the whole memory is considered dirty
+    uint16_t* cells() noexcept;
+
+    // Decoded instructions to invalidate on writes
+    void watch(DecodeCache* cache) noexcept;
+
 private:
-    uint16_t* memory;
+    static constexpr uint32_t WORDS = MEM_SIZE / 2 + 1; // The last word holds a word at the last cell
+
+    Word* memory;
+    DecodeCache* watcher = nullptr;
+    uint64_t dirty_pages = 0; // Pages written since the last clearing
+
+    static uint64_t page_bit(uint16_t address) noexcept { return uint64_t(1) << ((address >> PAGE_BITS) % PAGES); }
+
+    // Words at odd addresses are split between two memory words
+    Word get_split_word(uint16_t address) const noexcept;
+    void set_split_word(uint16_t address, Word word) noexcept;
 };
 
+inline Word Memory::get_word(uint16_t address) const noexcept
+{
+    if (address & 1) return get_split_word(address);
+    return memory[address >> 1];
+}
+
+inline void Memory::set_word(uint16_t address, Word word)
+{
+    if (address & 1) set_split_word(address, word);
+    else memory[address >> 1] = word;
+    dirty_pages |= page_bit(address);
+    if (watcher) watcher->invalidate(address);
+}
+
+inline void Memory::set_word(uint16_t address, uint16_t word_part1, uint16_t word_part2)
+{
+    Word word = Word();
+    word.cells[0] = word_part1;
+    word.cells[1] = word_part2;
+    set_word(address, word);
+}
+
 #endif // MEMORY_H
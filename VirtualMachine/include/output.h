@@ -0,0 +1,87 @@
+#ifndef OUTPUT_H
+#define OUTPUT_H
+
+#include "types.h"
+#include <charconv>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+// Buffer of the print commands (see output.cpp).
+// The numbers are formatted by std::to_chars into a reusable buffer, which is written
+// to the output stream by the flush policy and when it is full. Optionally a writer
+// thread writes the filled buffer while the processor fills the second one.
+class OutputChannel final
+{
+public:
+    static constexpr size_t DEFAULT_CAPACITY = 1 << 16;
+    static constexpr size_t MAX_NUMBER = 32; // Longest printed number with the line break
+
+    // When the buffer is written besides being full
+    enum class Flush : uint8_t
+    {
+        Exit,  // Only when the program ends
+        Read,  // Also before every read command, so the questions are seen before the answers
+        Bytes  // When the given number of bytes is collected
+    };
+
+    OutputChannel();
+    ~OutputChannel();
+    OutputChannel(const OutputChannel&) = delete;
+    OutputChannel& operator=(const OutputChannel&) = delete;
+
+    // Stream the buffer is written to
+    void set_sink(std::ostream* stream) noexcept { sink = stream; }
+
+    // Choosing the flush policy. The number of bytes is used by Flush::Bytes
+    void set_policy(Flush mode, size_t bytes = DEFAULT_CAPACITY);
+
+    // Writing the buffer on a separate thread
+    void set_writer_thread(bool enabled);
+
+    // Printing a number on a separate line as the output streams do
+    void print(int32_t value) noexcept { put(std::to_chars(buffer + used, buffer + limit + MAX_NUMBER, value).ptr); }
+    void print(uint32_t value) noexcept { put(std::to_chars(buffer + used, buffer + limit + MAX_NUMBER, value).ptr); }
+    void print(float value) noexcept
+    {
+        put(std::to_chars(buffer + used, buffer + limit + MAX_NUMBER, value, std::chars_format::general, 6).ptr);
+    }
+
+    // Called before a read command
+    void before_read() noexcept { if (policy == Flush::Read) flush(); }
+
+    // Writing the collected output
+    void flush() noexcept;
+
+    // Writing the collected output and waiting until the stream has it (when the program ends)
+    void finish() noexcept;
+
+private:
+    std::ostream* sink = &std::cout;
+    Flush policy = Flush::Read;
+    size_t limit = DEFAULT_CAPACITY; // Size after which the buffer is written
+    char* buffer;         // Buffer being filled (limit + MAX_NUMBER bytes)
+    size_t used = 0;
+
+    // Writer thread. It writes the second buffer while the processor fills the first one
+    std::thread writer;
+    std::mutex lock;
+    std::condition_variable changed;
+    char* spare = nullptr;   // Buffer that is not being filled
+    char* pending = nullptr; // Buffer given to the writer (nullptr - the writer is idle)
+    size_t pending_size = 0;
+    bool stopping = false;
+
+    void put(char* end) noexcept
+    {
+        *end++ = '\n';
+        used = size_t(end - buffer);
+        if (used >= limit) flush();
+    }
+
+    void write_loop();
+    void stop_writer();
+    void wait_writer() noexcept;
+};
+
+#endif // OUTPUT_H
@@ -0,0 +1,36 @@
+#ifndef POOL_H
+#define POOL_H
+
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <functional>
+#include "processor.h"
+
+// Processors kept between jobs. A new processor allocates and fills its memory,
+// decoded instructions and compiled code tables, while a released one is reset
+// cheaply (only the pages used by the last job are cleared) and given to the next job
+class ProcessorPool final
+{
+public:
+    // The configure function sets up every new processor (dispatch, fusion and so on)
+    explicit ProcessorPool(std::function<void(Processor&)> configure);
+    ProcessorPool(const ProcessorPool&) = delete;
+    ProcessorPool& operator=(const ProcessorPool&) = delete;
+
+    // Taking a reset processor from the pool or creating a new one
+    std::unique_ptr<Processor> acquire();
+
+    // Resetting the processor and returning it to the pool
+    void release(std::unique_ptr<Processor> proc);
+
+    // Number of processors waiting in the pool
+    size_t idle() const;
+
+private:
+    std::function<void(Processor&)> configure;
+    std::vector<std::unique_ptr<Processor>> processors;
+    mutable std::mutex lock;
+};
+
+#endif // POOL_H
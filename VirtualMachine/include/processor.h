@@ -3,6 +3,11 @@
 
 #include "command.h"
 #include "memory.h"
+#include "jit.h"
+#include "profile.h"
+#include "trace.h"
+#include "output.h"
+#include "input.h"
 
 class Processor final
 {
@@ -11,20 +16,62 @@ public:
     static constexpr int AMOUNT_COMMANDS = 55;
     static constexpr int START_STACK = 240; // Register from which the stack simulation starts
 
+    // Way of dispatching instructions in the run loop
+    enum class Dispatch
+    {
+        Virtual,  // Virtual call of the Command object from the commands table
+        Threaded, // Jump table of labels (computed goto) or switch over the opcodes
+        Jit       // Hot blocks compiled into native code, the rest by the Command objects
+    };
+
+    // Operation whose flags are calculated only when they are read
+    enum class FlagsOp : uint8_t
+    {
+        Int,      // Zero, parity and sign of the integer result
+        AddInt,   // Same and the overflow flags of the addition of the operands
+        SubInt,   // Same and the overflow flags of the subtraction
+        MulInt,   // Same and the overflow flags of the multiplication
+        Float,    // Zero and sign of the fractional result
+        AddFloat, // Same and the overflow flag of the addition
+        MulFloat  // Same and the overflow flag of the multiplication
+    };
+
     Memory memory = Memory();  // Memory class
+    DecodeCache decoded; // Pre-decoded instructions for the threaded run loop
+    Jit jit; // Compiler of hot blocks for the JIT run loop
     uint16_t address_regs[ADDRESS_REGS]; //Address registers
-    uint16_t flags; // Status Flags
+    uint16_t flags; // Status Flags. The bits of the deferred flags are valid only after sync_flags
+    unsigned long long fused_executed = 0; // Fused instruction pairs executed in the last threaded run
+    uint32_t dead_flag_updates = 0; // Instructions whose flag updates are never read (last threaded run)
+    unsigned long long flag_updates_skipped = 0; // Executions of these instructions without the flag update
+    bool count_flag_updates = false; // Count flag_updates_skipped (--stats), the run is slower then
+    std::istream* input = &std::cin;   // Stream of the read commands
+    InputChannel reader; // Source of the read commands (input or the whole input in memory)
+    std::ostream* output = &std::cout; // Stream of the print commands
+    OutputChannel printer; // Buffer of the print commands, written to output (flushed when run returns)
+    Profiler* profiler = nullptr; // Counters of a profiled run (nullptr - the run is not profiled)
+    Tracer* tracer = nullptr; // Trace of the executed instructions (nullptr - not traced)
 
     Processor();
 
-    // Resetting values ​​in memory and registers
+    // Resetting values ​​in memory, registers and flags
     void reset() noexcept;
 
     // Starting the processor
     void run(uint16_t start_address);
 
+    void set_dispatch(Dispatch mode) noexcept;
+
+    // Executing a command that is not a transition by its Command object
+    void exec_command(Word word) noexcept;
+
     void set_flag(uint8_t flag_index, bool is_true) noexcept;
-    bool get_flag(uint8_t flag_index) const noexcept;
+    bool get_flag(uint8_t flag_index) noexcept;
+
+    // Remembering the result and the operands of an operation instead of setting its flags
+    void defer_flags(FlagsOp op, Word result, Word operand1 = Word(), Word operand2 = Word()) noexcept;
+    // Calculating the deferred flags before the flags are accessed directly
+    void sync_flags() noexcept { if (deferred.mask != 0) calc_flags(); }
 
     uint16_t get_ip() const noexcept;
     void set_ip(uint16_t instruction_pointer) noexcept;
@@ -35,17 +82,79 @@ public:
 private:
     uint16_t ip; // Instruction Pointer
     uint8_t sp; // Pointer to the top of the stack
+    Dispatch dispatch = Dispatch::Threaded; // Instruction dispatch method
+
+    // Sources of the flags that have not been calculated yet. Every group of flags
+    // keeps the operation that set it last, so deferring never calculates anything
+    struct DeferredFlags
+    {
+        uint16_t mask = 0;     // Bits of the flags that are not calculated
+        Word result = Word();  // Result for the zero and sign flags
+        bool is_float = false; // Is the result fractional
+        Word parity = Word();  // Last integer result for the parity flag
+        FlagsOp int_op = FlagsOp::AddInt;     // Last integer operation with overflow flags
+        Word int1 = Word(), int2 = Word();    // and its operands
+        FlagsOp float_op = FlagsOp::AddFloat; // Last fractional operation with the overflow flag
+        Word float1 = Word(), float2 = Word(); // and its operands
+    } deferred;
+
+    void calc_flags() noexcept;
 
-    // Array of pointers to processor instructions
-    Command* commands[AMOUNT_COMMANDS] = { nullptr, new JumpCm(), new JEqCm(), new JEqUCm(), new JEqFCm(),
-        new JGrCm(), new JGrUCm(), new JGrFCm(), new JLsCm(), new JLsUCm(), new JLsFCm(),
-        new JNEqCm(), new JNEqUCm(), new JNEqFCm(), new JGEqCm(), new JGEqUCm(), new JGEqFCm(),
-        new JLEqCm(), new JLEqUCm(), new JLEqFCm(), new PrintCm(), new PrintUCm(), new PrintFCm(),
-        new LoadCm(), new NegCm(), new NegFCm(), new CmpCm(), new CmpUCm(), new CmpFCm(), new AddCm(),
-        new AddFCm(), new SubCm(), new SubFCm(), new MulCm(), new MulFCm(), new DivUCm(), new DivCm(),
-        new DivFCm(), new ModUCm(), new ModCm(), new IncCm(), new DecCm(), new ReadCm(), new ReadUCm(),
-        new ReadFCm(), new AndCm(), new OrCm(), new XorCm(), new NotCm(), new LoadRCm(), new LoadRVCm(),
-        new CallCm(), new LoadF(), new SetF(), new EndpCm() };
+    // Run loop calling the Command objects
+    void run_virtual(uint16_t start_address);
+    // Run loop with direct-threaded dispatch (see dispatch.cpp)
+    void run_threaded(uint16_t start_address);
+    // Run loop compiling hot blocks (see jit.cpp)
+    void run_jit(uint16_t start_address);
+    // Run loop calling the Command objects for the profiler and the tracer
+    void run_instrumented(uint16_t start_address);
+
+    // Array of pointers to processor instructions. The commands have no state,
+    // so one table is shared by all processors (see processor.cpp)
+    static const Command* const commands[AMOUNT_COMMANDS];
 };
 
+// Setting a Flag Value
+inline void Processor::set_flag(uint8_t flag_index, bool is_true) noexcept
+{
+    deferred.mask &= ~(1 << flag_index); // The set value replaces the deferred one
+    if (is_true) flags |= (1 << flag_index);
+    else flags &= ~(1 << flag_index);
+}
+
+// Getting the value of a flag
+inline bool Processor::get_flag(uint8_t flag_index) noexcept
+{
+    int16_t mask = 1 << flag_index;
+    if (deferred.mask & mask) calc_flags();
+    return (flags & mask) != 0;
+}
+
+// Remembering the result and the operands of an operation instead of setting its flags
+inline void Processor::defer_flags(FlagsOp op, Word result, Word operand1, Word operand2) noexcept
+{
+    deferred.result = result;
+    if (op <= FlagsOp::MulInt)
+    {
+        deferred.is_float = false;
+        deferred.parity = result;
+        deferred.mask |= 1 << 0 | 1 << 1 | 1 << 8;
+        if (op == FlagsOp::Int) return;
+        deferred.int_op = op;
+        deferred.int1 = operand1;
+        deferred.int2 = operand2;
+        deferred.mask |= 1 << 9 | 1 << 10;
+    }
+    else
+    {
+        deferred.is_float = true;
+        deferred.mask |= 1 << 0 | 1 << 8;
+        if (op == FlagsOp::Float) return;
+        deferred.float_op = op;
+        deferred.float1 = operand1;
+        deferred.float2 = operand2;
+        deferred.mask |= 1 << 11;
+    }
+}
+
 #endif // PROCESSOR_H
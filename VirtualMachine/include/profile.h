@@ -0,0 +1,55 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include "types.h"
+
+// Execution counters of a profiled run (see profile.cpp).
+// The processor counts the executions of every operation code and of every
+// instruction address, the taken and not taken conditional jumps and the calls
+// of every subroutine. The run loops without profiling do not count anything.
+class Profiler final
+{
+public:
+    static constexpr uint32_t SIZE = 65536; // The whole 16-bit address space
+    static constexpr uint32_t CODES = 256;  // Every value of the operation code byte
+
+    Profiler();
+    ~Profiler();
+    Profiler(const Profiler&) = delete;
+    Profiler& operator=(const Profiler&) = delete;
+
+    // Resetting all counters
+    void clear() noexcept;
+
+    // Counting an executed instruction
+    void count(uint16_t address, uint8_t cmd) noexcept
+    {
+        opcodes[cmd]++;
+        addresses[address]++;
+    }
+
+    // Counting the result of a conditional jump
+    void branch(uint16_t address, bool is_taken) noexcept
+    {
+        if (is_taken) taken[address]++;
+        else not_taken[address]++;
+    }
+
+    // Counting a call of the subroutine at the address
+    void call(uint16_t target) noexcept { calls[target]++; }
+
+    // Writing the counters sorted from the largest
+    void report(std::ostream& out) const;
+
+    // Name of an operation code in the assembler
+    static const char* mnemonic(uint8_t cmd) noexcept;
+
+private:
+    unsigned long long opcodes[CODES];
+    unsigned long long* addresses; // Executions of the instruction at every address
+    unsigned long long* taken;     // Taken conditional jumps at every address
+    unsigned long long* not_taken; // Conditional jumps that went to the next instruction
+    unsigned long long* calls;     // Calls of the subroutine at every address
+};
+
+#endif // PROFILE_H
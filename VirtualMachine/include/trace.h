@@ -0,0 +1,89 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include "types.h"
+#include <atomic>
+#include <string>
+
+// Executed instruction in the trace (16 bytes, the byte order of the machine)
+struct TraceRecord
+{
+    uint16_t ip;          // Address of the instruction
+    uint16_t flags;       // Status flags after the instruction
+    uint32_t word;        // The instruction word (operation code and operands)
+    uint16_t operands[3]; // Values of the address registers of the operands before the instruction
+    uint16_t reserved;
+};
+
+// Beginning of the trace file, followed by the records from the oldest one
+struct TraceHeader
+{
+    char magic[4];        // "VM9T"
+    uint16_t version;
+    uint16_t record_size; // sizeof(TraceRecord)
+    uint64_t records;     // Records in the file
+    uint64_t executed;    // Instructions executed since the start of the trace
+};
+
+// Execution trace of the last instructions (see trace.cpp).
+// The records are kept in a ring buffer of a fixed size, which has one writer (the
+// run loop) and is read only when the trace is dumped into the file: when the trigger
+// address is reached (or, without it, when the program ends) and when the process
+// gets SIGUSR1.
+// Dumping uses only system calls, so it can be done by the signal handler.
+class Tracer final
+{
+public:
+    static constexpr uint32_t DEFAULT_CAPACITY = 1 << 16; // Records kept by default
+    static constexpr uint16_t VERSION = 1;
+
+    // The capacity is rounded up to a power of two
+    explicit Tracer(const std::string& path, uint32_t capacity = DEFAULT_CAPACITY);
+    ~Tracer();
+    Tracer(const Tracer&) = delete;
+    Tracer& operator=(const Tracer&) = delete;
+
+    // Dumping the trace when the instruction at the address is reached for the first time
+    void set_trigger(uint16_t address) noexcept;
+
+    // Is the address the trigger reached for the first time
+    bool reach(uint16_t address) noexcept
+    {
+        if (!has_trigger || address != trigger) return false;
+        has_trigger = false;
+        triggered = true;
+        return true;
+    }
+
+    // Was the trace dumped at the trigger (then it is not dumped again when the program ends)
+    bool was_triggered() const noexcept { return triggered; }
+
+    // Adding a record, the oldest one is overwritten when the buffer is full
+    void record(const TraceRecord& rec) noexcept
+    {
+        uint64_t position = written.load(std::memory_order_relaxed);
+        records[position & mask] = rec;
+        written.store(position + 1, std::memory_order_release);
+    }
+
+    // Writing the kept records into the file. Returns false if the file cannot be written
+    bool dump() const noexcept;
+
+    // Dumping the trace of this tracer when the process gets SIGUSR1 (nullptr - not dumping)
+    static void dump_on_signal(Tracer* tracer) noexcept;
+
+private:
+    std::string path;
+    TraceRecord* records;
+    uint64_t mask; // Capacity - 1
+    std::atomic<uint64_t> written{0}; // Records added since the start
+    uint16_t trigger = 0;
+    bool has_trigger = false;
+    bool triggered = false;
+
+    static_assert(sizeof(TraceRecord) == 16, "Trace records are written as they are kept");
+    static_assert(sizeof(TraceHeader) == 24, "The trace header is written as it is kept");
+    static_assert(std::atomic<uint64_t>::is_always_lock_free, "The signal handler reads the counter");
+};
+
+#endif // TRACE_H
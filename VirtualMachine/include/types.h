@@ -29,4 +29,38 @@ union Word
     float fval; // Fractional representation of a word
 };
 
+// Result of an addition or a multiplication of fractions. When both operands are NaN the
+// processor returns one of them, and which one depends on the order of the operands chosen
+// by the compiler, so every engine takes the first operand (made quiet) explicitly
+inline Word float_result(float value, Word word1, Word word2) noexcept
+{
+    Word res;
+    res.fval = value;
+    if (value != value && word1.fval != word1.fval && word2.fval != word2.fval)
+        res.uval = word1.uval | 0x00400000u;
+    return res;
+}
+
+inline Word add_float(Word word1, Word word2) noexcept
+{
+    return float_result(word1.fval + word2.fval, word1, word2);
+}
+
+inline Word mul_float(Word word1, Word word2) noexcept
+{
+    return float_result(word1.fval * word2.fval, word1, word2);
+}
+
+// Operation codes of the processor instructions (same order as in the assembler)
+enum Opcode : uint8_t
+{
+    OP_END = 0, OP_JMP, OP_JE, OP_JEU, OP_JEF, OP_JG, OP_JGU, OP_JGF, OP_JL, OP_JLU, OP_JLF,
+    OP_JNE, OP_JNEU, OP_JNEF, OP_JGE, OP_JGEU, OP_JGEF, OP_JLE, OP_JLEU, OP_JLEF,
+    OP_PRINT, OP_PRINTU, OP_PRINTF, OP_LOAD, OP_NEG, OP_NEGF, OP_CMP, OP_CMPU, OP_CMPF,
+    OP_ADD, OP_ADDF, OP_SUB, OP_SUBF, OP_MUL, OP_MULF, OP_DIVU, OP_DIV, OP_DIVF, OP_MODU, OP_MOD,
+    OP_INC, OP_DEC, OP_READ, OP_READU, OP_READF, OP_AND, OP_OR, OP_XOR, OP_NOT,
+    OP_LOADR, OP_LOADRV, OP_CALL, OP_LOADF, OP_SETF, OP_ENDP,
+    OP_AMOUNT // Number of operation codes
+};
+
 #endif // TYPES_H
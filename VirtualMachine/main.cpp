@@ -3,16 +3,196 @@
 // Virtual Machine VM09.
 
 #include <iostream>
+#include <cstring>
+#include <cstdlib>
+#include <thread>
+#include <fstream>
+#include <memory>
 #include "loader.h"
+#include "batch.h"
 
 
 int main(int argc, char **argv)
 {
-    Processor proc = Processor();
+    char* filename = nullptr;
+    char* batch_list = nullptr;
+    unsigned batch_workers = std::thread::hardware_concurrency();
+    bool print_stats = false;
+    unsigned bench_runs = 0;
+    unsigned bench_lines = 0;
+    unsigned load_threads = std::thread::hardware_concurrency();
+    bool profile = false;
+    char* profile_path = nullptr;
+    char* trace_path = nullptr;
+    uint32_t trace_size = Tracer::DEFAULT_CAPACITY;
+    long trace_trigger = -1;
+    char* input_path = nullptr;
+    bool binary_input = false;
+
+    // Settings applied to every processor
+    Processor::Dispatch dispatch = Processor::Dispatch::Threaded;
+    bool fusion = true, flag_analysis = true;
+    int jit_threshold = Jit::DEFAULT_THRESHOLD;
+    OutputChannel::Flush flush_policy = OutputChannel::Flush::Read;
+    size_t flush_bytes = OutputChannel::DEFAULT_CAPACITY;
+    bool writer_thread = false;
+
+    // Options before the file to execute:
+    // --dispatch=virtual | --dispatch=threaded, --no-fusion, --no-flag-analysis, --stats,
+    // --jit, --jit-threshold=N (entries after which a block is compiled),
+    // --batch=LIST (file with the jobs, see batch.h), --jobs=N (worker threads of the batch),
+    // --bench-startup=N (time per job of N runs on new and on pooled processors),
+    // --load-threads=N (threads that parse a large text code file),
+    // --bench-load=N (loading speed of a generated text file with N lines),
+    // --profile | --profile=FILE (execution counters of the run, to stderr or to the file),
+    // --trace=FILE (binary trace of the last instructions), --trace-size=N (records kept),
+    // --trace-trigger=ADDRESS (dump the trace when the instruction is reached),
+    // --flush=exit | --flush=read | --flush=N (when the printed output is written), --writer-thread,
+    // --input=FILE (the whole input of the read commands in memory, - for stdin),
+    // --binary-input (the input is 32-bit words)
+    for (int i = 1; i < argc; i++)
+    {
+        if (std::strcmp(argv[i], "--dispatch=virtual") == 0)
+            dispatch = Processor::Dispatch::Virtual;
+        else if (std::strcmp(argv[i], "--dispatch=threaded") == 0)
+            dispatch = Processor::Dispatch::Threaded;
+        else if (std::strcmp(argv[i], "--no-fusion") == 0)
+            fusion = false;
+        else if (std::strcmp(argv[i], "--no-flag-analysis") == 0)
+            flag_analysis = false;
+        else if (std::strcmp(argv[i], "--jit") == 0)
+            dispatch = Processor::Dispatch::Jit;
+        else if (std::strncmp(argv[i], "--jit-threshold=", 16) == 0)
+            jit_threshold = std::atoi(argv[i] + 16);
+        else if (std::strncmp(argv[i], "--batch=", 8) == 0)
+            batch_list = argv[i] + 8;
+        else if (std::strncmp(argv[i], "--jobs=", 7) == 0)
+            batch_workers = std::atoi(argv[i] + 7);
+        else if (std::strncmp(argv[i], "--bench-startup=", 16) == 0)
+            bench_runs = std::atoi(argv[i] + 16);
+        else if (std::strncmp(argv[i], "--load-threads=", 15) == 0)
+            load_threads = std::atoi(argv[i] + 15);
+        else if (std::strncmp(argv[i], "--bench-load=", 13) == 0)
+            bench_lines = std::atoi(argv[i] + 13);
+        else if (std::strcmp(argv[i], "--profile") == 0)
+            profile = true;
+        else if (std::strncmp(argv[i], "--profile=", 10) == 0)
+        {
+            profile = true;
+            profile_path = argv[i] + 10;
+        }
+        else if (std::strncmp(argv[i], "--trace=", 8) == 0)
+            trace_path = argv[i] + 8;
+        else if (std::strncmp(argv[i], "--trace-size=", 13) == 0)
+            trace_size = std::atoi(argv[i] + 13);
+        else if (std::strncmp(argv[i], "--trace-trigger=", 16) == 0)
+            trace_trigger = std::atol(argv[i] + 16);
+        else if (std::strcmp(argv[i], "--flush=exit") == 0)
+            flush_policy = OutputChannel::Flush::Exit;
+        else if (std::strcmp(argv[i], "--flush=read") == 0)
+            flush_policy = OutputChannel::Flush::Read;
+        else if (std::strncmp(argv[i], "--flush=", 8) == 0)
+        {
+            flush_policy = OutputChannel::Flush::Bytes;
+            flush_bytes = std::atol(argv[i] + 8);
+        }
+        else if (std::strcmp(argv[i], "--writer-thread") == 0)
+            writer_thread = true;
+        else if (std::strncmp(argv[i], "--input=", 8) == 0)
+            input_path = argv[i] + 8;
+        else if (std::strcmp(argv[i], "--binary-input") == 0)
+            binary_input = true;
+        else if (std::strcmp(argv[i], "--stats") == 0)
+            print_stats = true;
+        else
+            filename = argv[i];
+    }
+
+    auto configure = [&](Processor& proc)
+    {
+        proc.set_dispatch(dispatch);
+        if (!fusion) proc.decoded.set_fusion(false);
+        if (!flag_analysis) proc.decoded.set_flag_analysis(false);
+        proc.count_flag_updates = print_stats;
+        proc.jit.set_threshold(jit_threshold);
+        proc.printer.set_policy(flush_policy, flush_bytes);
+        proc.printer.set_writer_thread(writer_thread);
+    };
+
+    // Running a list of programs on several threads
+    if (batch_list)
+    {
+        std::vector<BatchJob> jobs;
+        if (!read_batch_list(batch_list, jobs))
+        {
+            std::cout << "Failed to open file.\n";
+            return 1;
+        }
+        run_batch(jobs, batch_workers, configure);
+
+        // The output of the jobs without an output file is printed in the order of the list
+        for (const BatchJob& job : jobs)
+            if (job.output_path.empty())
+                std::cout << "==> " << job.program << " <==\n" << job.output;
+        return 0;
+    }
+
+    // Measuring the startup of the jobs that run the program
+    if (bench_runs > 0 && filename)
+    {
+        bench_startup(filename, bench_runs, configure);
+        return 0;
+    }
+
+    // Measuring the loading speed of the text format
+    if (bench_lines > 0)
+    {
+        bench_loader(bench_lines, load_threads);
+        return 0;
+    }
 
     // Loading a program from a file into memory and running it
-    if (argc > 1)
-        load(proc, argv[1]);
+    if (filename)
+    {
+        Processor proc = Processor();
+        configure(proc);
+        // Binary input without a file is the standard input
+        if ((input_path || binary_input) && !proc.reader.open(input_path ? input_path : "-",
+            binary_input ? InputChannel::Mode::Binary : InputChannel::Mode::Text))
+        {
+            std::cout << "Failed to open file.\n";
+            return 1;
+        }
+        std::unique_ptr<Profiler> profiler(profile ? new Profiler() : nullptr);
+        proc.profiler = profiler.get();
+        std::unique_ptr<Tracer> tracer(trace_path ? new Tracer(trace_path, trace_size) : nullptr);
+        if (tracer)
+        {
+            if (trace_trigger >= 0) tracer->set_trigger(uint16_t(trace_trigger));
+            Tracer::dump_on_signal(tracer.get());
+            proc.tracer = tracer.get();
+        }
+        load(proc, filename, load_threads);
+        if (tracer)
+        {
+            Tracer::dump_on_signal(nullptr);
+            if (!tracer->was_triggered() && !tracer->dump()) std::cerr << "Failed to write the trace.\n";
+        }
+        // Statistics go to stderr so that they do not mix with the program output
+        if (print_stats)
+        {
+            std::cerr << "Fused instruction pairs executed: " << proc.fused_executed << '\n';
+            std::cerr << "Instructions with unread flag updates: " << proc.dead_flag_updates << '\n';
+            std::cerr << "Flag updates skipped when executed: " << proc.flag_updates_skipped << '\n';
+        }
+        if (profiler && profile_path)
+        {
+            std::ofstream fout(profile_path, std::ios::out | std::ios::trunc);
+            profiler->report(fout);
+        }
+        else if (profiler)
+            profiler->report(std::cerr);
+    }
     else
         std::cout << "Specify the file to execute.\n";
     return 0;
@@ -0,0 +1,136 @@
+#include "batch.h"
+#include "loader.h"
+#include "pool.h"
+#include <atomic>
+#include <chrono>
+#include <string_view>
+#include <thread>
+
+// Next part of a line of the list: the parts are separated by spaces, and the part "#"
+// begins a comment. Empty at the end of the line
+static std::string_view next_part(std::string_view line, size_t& pos) noexcept
+{
+    while (pos < line.size() && line[pos] == ' ') pos++;
+    size_t start = pos;
+    while (pos < line.size() && line[pos] != ' ') pos++;
+    std::string_view part = line.substr(start, pos - start);
+    return part == "#" ? std::string_view() : part;
+}
+
+// Reading the list of jobs
+bool read_batch_list(const char* filename, std::vector<BatchJob>& jobs)
+{
+    std::ifstream fin(filename);
+    if (!fin) return false;
+
+    std::string line;
+    while (std::getline(fin, line))
+    {
+        size_t pos = 0;
+        std::string_view program = next_part(line, pos);
+        if (program.empty()) continue;
+
+        BatchJob job;
+        job.program = program;
+        std::string_view input = next_part(line, pos);
+        job.input = input;
+        if (!input.empty()) job.output_path = next_part(line, pos);
+        jobs.push_back(job);
+    }
+    return true;
+}
+
+// Loading and running one job. The output is collected in a string, so the jobs
+// running at the same time do not mix their output
+static void run_job(Processor& proc, BatchJob& job)
+{
+    std::istringstream no_input;
+    std::ostringstream out;
+    proc.input = &no_input;
+    proc.output = &out;
+
+    // The input file is taken as a whole. Without it every read gives zero,
+    // a missing input file is an error as in a single run
+    if (!job.input.empty() && !proc.reader.open(job.input.c_str(), InputChannel::Mode::Text))
+        out << "Failed to open file.\n";
+    else
+    {
+        uint16_t run_address = 0;
+        LoadStatus status = load_program(proc, job.program.c_str(), run_address);
+        job.loaded = status == LoadStatus::Loaded;
+        if (job.loaded) proc.run(run_address);
+        else if (status == LoadStatus::NotOpened) out << "Failed to open file.\n";
+    }
+    job.output = out.str();
+    proc.reader.close();
+
+    if (!job.output_path.empty())
+    {
+        std::ofstream fout(job.output_path, std::ios::out | std::ios::trunc);
+        fout << job.output;
+    }
+}
+
+// Running the jobs on worker threads. Every job takes a processor from the pool
+// and returns it after the run, so only the first jobs create processors
+void run_batch(std::vector<BatchJob>& jobs, unsigned workers, const std::function<void(Processor&)>& configure)
+{
+    if (workers == 0) workers = 1;
+    if (workers > jobs.size()) workers = unsigned(jobs.size());
+
+    ProcessorPool pool(configure);
+    std::atomic<size_t> next_job(0);
+    auto worker = [&jobs, &next_job, &pool]()
+    {
+        for (size_t i = next_job++; i < jobs.size(); i = next_job++)
+        {
+            std::unique_ptr<Processor> proc = pool.acquire();
+            run_job(*proc, jobs[i]);
+            pool.release(std::move(proc));
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (unsigned i = 0; i < workers; i++)
+        threads.emplace_back(worker);
+    for (std::thread& thread : threads)
+        thread.join();
+}
+
+// Measuring the startup of the jobs: the program is run the given number of times
+// on new processors and on processors from a pool. The output is discarded
+void bench_startup(const char* program, unsigned runs, const std::function<void(Processor&)>& configure)
+{
+    using Clock = std::chrono::steady_clock;
+    BatchJob job;
+    job.program = program;
+
+    Clock::time_point start = Clock::now();
+    for (unsigned i = 0; i < runs; i++)
+    {
+        std::unique_ptr<Processor> proc(new Processor());
+        configure(*proc);
+        run_job(*proc, job);
+    }
+    double cold = std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+
+    ProcessorPool pool(configure);
+    pool.release(pool.acquire()); // The pool is warmed up by one processor
+    start = Clock::now();
+    for (unsigned i = 0; i < runs; i++)
+    {
+        std::unique_ptr<Processor> proc = pool.acquire();
+        run_job(*proc, job);
+        pool.release(std::move(proc));
+    }
+    double pooled = std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+
+    if (!job.loaded)
+    {
+        std::cout << job.output;
+        return;
+    }
+    std::cout << "Runs: " << runs << '\n';
+    std::cout << "New processor per job: " << cold / runs << " us per job\n";
+    std::cout << "Processor from the pool: " << pooled / runs << " us per job\n";
+}
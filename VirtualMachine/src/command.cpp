@@ -11,21 +11,21 @@ void LoadCm::operator()(Word word, Processor& proc) const noexcept
 void PrintCm::operator()(Word word, Processor& proc) const noexcept
 {
     word = proc.memory.get_word(proc.address_regs[word.cmd3ops.regs[2]]);
-    std::cout << word.ival << std::endl;
+    proc.printer.print(word.ival);
 }
 
 // Outputting the unsigned integer value pointed to by the address register
 void PrintUCm::operator()(Word word, Processor& proc) const noexcept
 {
     word = proc.memory.get_word(proc.address_regs[word.cmd3ops.regs[2]]);
-    std::cout <<  word.uval << std::endl;
+    proc.printer.print(word.uval);
 }
 
 // Printing the fractional value pointed to by the address register
 void PrintFCm::operator()(Word word, Processor& proc) const noexcept
 {
     word = proc.memory.get_word(proc.address_regs[word.cmd3ops.regs[2]]);
-    std::cout << word.fval << std::endl;
+    proc.printer.print(word.fval);
 }
 
 // Get value from processor register
@@ -42,18 +42,15 @@ void Command::set_reg_val(uint8_t reg, Word word, Processor& proc) const noexcep
     proc.memory.set_word(adrs, word);
 }
 
-// Setting flags
+// Setting flags. They are calculated by the processor when they are read
 void Command::set_flags_int(Word word, Processor& proc) const noexcept
 {
-    proc.set_flag(0, word.ival == 0); // Equal to zero flag
-    proc.set_flag(1, abs(word.ival) % 2 == 0); // Parity flag
-    proc.set_flag(8, word.ival < 0); // Sign flag (1 if number is negative)
+    proc.defer_flags(Processor::FlagsOp::Int, word);
 }
 
 void Command::set_flags_float(Word word, Processor& proc) const noexcept
 {
-    proc.set_flag(0, word.fval == 0); // Equal to zero flag
-    proc.set_flag(8, word.fval < 0); // Sign flag (1 if number is negative)
+    proc.defer_flags(Processor::FlagsOp::Float, word);
 }
 
 // Addition operations with setting flags (for subtraction, pass the is_sub=True argument)
@@ -61,15 +58,11 @@ Word ArithCm::add_int_check_overflow(uint8_t reg1, uint8_t reg2, Processor& proc
 {
     Word word1 = get_reg_val(reg1, proc);
     Word word2 = get_reg_val(reg2, proc);
-    if (is_sub) word2.ival = -word2.ival;
     Word sum_result = Word();
-    sum_result.uval = word1.uval + word2.uval;
+    sum_result.uval = is_sub ? word1.uval - word2.uval : word1.uval + word2.uval;
 
-    long long_res = (long)word1.ival + (long)word2.ival;
-    proc.set_flag(9, long_res != sum_result.ival); // Signed integer overflow flag
-    proc.set_flag(10, long_res != sum_result.uval); // Carry flag (unsigned integer overflow)
-
-    set_flags_int(sum_result, proc);
+    // The overflow flags are calculated in 64 bits when they are read
+    proc.defer_flags(is_sub ? Processor::FlagsOp::SubInt : Processor::FlagsOp::AddInt, sum_result, word1, word2);
     return sum_result;
 }
 
@@ -77,14 +70,12 @@ Word ArithCm::add_float_check_overflow(uint8_t reg1, uint8_t reg2, Processor& pr
 {
     Word word1 = get_reg_val(reg1, proc);
     Word word2 = get_reg_val(reg2, proc);
-    if (is_sub) word2.fval = -word2.fval;
-    Word sum_result = Word();
-    sum_result.fval = word1.fval + word2.fval;
-
-    double double_res = (double)word1.fval + (double)word2.fval;
-    proc.set_flag(11, double_res != sum_result.fval); // Fractional overflow flag
+    // The sign bit is flipped explicitly, so the sign of a NaN does not depend on
+    // whether the compiler turns the negation and the addition into a subtraction
+    if (is_sub) word2.uval ^= 0x80000000u;
+    Word sum_result = add_float(word1, word2);
 
-    set_flags_float(sum_result, proc);
+    proc.defer_flags(Processor::FlagsOp::AddFloat, sum_result, word1, word2);
     return sum_result;
 }
 
@@ -122,13 +113,9 @@ Word ArithCm::mul_int_check_overflow(uint8_t reg1, uint8_t reg2, Processor& proc
     Word word1 = get_reg_val(reg1, proc);
     Word word2 = get_reg_val(reg2, proc);
     Word result = Word();
-    result.ival = word1.ival * word2.ival;
+    result.uval = word1.uval * word2.uval; // Lower 32 bits of the product
 
-    long long_res = (long)word1.ival * (long)word2.ival;
-    proc.set_flag(9, long_res != result.ival); // Sign integer overflow flag
-    proc.set_flag(10, long_res != result.uval); // Carry flag (unsigned integer overflow)
-
-    set_flags_int(result, proc);
+    proc.defer_flags(Processor::FlagsOp::MulInt, result, word1, word2);
     return result;
 }
 
@@ -136,13 +123,9 @@ Word ArithCm::mul_float_check_overflow(uint8_t reg1, uint8_t reg2, Processor& pr
 {
     Word word1 = get_reg_val(reg1, proc);
     Word word2 = get_reg_val(reg2, proc);
-    Word result = Word();
-    result.fval = word1.fval * word2.fval;
-
-    double double_res = (double)word1.fval * (double)word2.fval;
-    proc.set_flag(11, double_res != result.fval); // Fractional overflow flag
+    Word result = mul_float(word1, word2);
 
-    set_flags_float(result, proc);
+    proc.defer_flags(Processor::FlagsOp::MulFloat, result, word1, word2);
     return result;
 }
 
@@ -483,7 +466,7 @@ void JLEqFCm::operator()(Word word, Processor& proc) const noexcept
 void ReadCm::operator()(Word word, Processor& proc) const noexcept
 {
     Word user_val = Word();
-    std::cin >> user_val.ival;
+    user_val.ival = proc.reader.read_int();
     set_reg_val(word.cmd3ops.regs[2], user_val, proc);
 }
 
@@ -491,7 +474,7 @@ void ReadCm::operator()(Word word, Processor& proc) const noexcept
 void ReadUCm::operator()(Word word, Processor& proc) const noexcept
 {
     Word user_val = Word();
-    std::cin >> user_val.uval;
+    user_val.uval = proc.reader.read_uint();
     set_reg_val(word.cmd3ops.regs[2], user_val, proc);
 }
 
@@ -499,7 +482,7 @@ void ReadUCm::operator()(Word word, Processor& proc) const noexcept
 void ReadFCm::operator()(Word word, Processor& proc) const noexcept
 {
     Word user_val = Word();
-    std::cin >> user_val.fval;
+    user_val.fval = proc.reader.read_float();
     set_reg_val(word.cmd3ops.regs[2], user_val, proc);
 }
 
@@ -0,0 +1,175 @@
+#include "decode.h"
+
+DecodeCache::~DecodeCache()
+{
+    delete[] records;
+}
+
+// Preparing the records for a run loop with the given decoding label
+void DecodeCache::attach(const void* decoder)
+{
+    if (records != nullptr && this->decoder == decoder) return;
+
+    this->decoder = decoder;
+    if (records == nullptr) records = new DecodedCmd[SIZE];
+    used_pages = ~uint64_t(0); // Every empty record gets the new handler
+    clear();
+}
+
+// Emptying all records. Only the pages with decoded records are visited
+void DecodeCache::clear() noexcept
+{
+    if (records == nullptr) return;
+    constexpr uint32_t PAGE_SIZE = SIZE / 64;
+    for (uint32_t page = 0; page < 64; page++)
+    {
+        if (!(used_pages & (uint64_t(1) << page))) continue;
+        for (uint32_t i = page * PAGE_SIZE; i < (page + 1) * PAGE_SIZE; i++)
+        {
+            records[i] = DecodedCmd();
+            records[i].cmd = NOT_DECODED;
+            records[i].handler = decoder;
+        }
+    }
+    used_pages = 0;
+}
+
+// Turning the fusion of instruction pairs on or off
+void DecodeCache::set_fusion(bool enabled)
+{
+    fusion = enabled;
+    clear();
+}
+
+// Finding the flag updates that are never read in the program starting at the address
+uint32_t DecodeCache::analyze_flags(const Memory& memory, uint16_t start)
+{
+    uint32_t dead = 0;
+    if (flag_analysis) dead = liveness.analyze(memory, start);
+    else liveness.discard();
+    clear();
+    return dead;
+}
+
+// Turning the use of the flag analysis on or off
+void DecodeCache::set_flag_analysis(bool enabled)
+{
+    flag_analysis = enabled;
+    liveness.discard();
+    clear();
+}
+
+// The analysed code has changed: the records decoded with the analysis are emptied
+void DecodeCache::drop_flag_analysis() noexcept
+{
+    liveness.discard();
+    clear();
+    code_written = true;
+}
+
+// Variant of an instruction that does not update the flags
+static uint8_t without_flags(uint8_t cmd) noexcept
+{
+    switch (cmd)
+    {
+    case OP_ADD: return OP_ADD_NOFLAGS;
+    case OP_SUB: return OP_SUB_NOFLAGS;
+    case OP_MUL: return OP_MUL_NOFLAGS;
+    case OP_ADDF: return OP_ADDF_NOFLAGS;
+    case OP_SUBF: return OP_SUBF_NOFLAGS;
+    case OP_MULF: return OP_MULF_NOFLAGS;
+    case OP_AND: return OP_AND_NOFLAGS;
+    case OP_OR: return OP_OR_NOFLAGS;
+    case OP_XOR: return OP_XOR_NOFLAGS;
+    case OP_NOT: return OP_NOT_NOFLAGS;
+    case OP_INC: return OP_INC_NOFLAGS;
+    case OP_DEC: return OP_DEC_NOFLAGS;
+    case OP_CMP: case OP_CMPU: case OP_CMPF: return OP_SKIP;
+    case OP_CMP_JUMP: return OP_CMP_JUMP_NOFLAGS;
+    case OP_CMPU_JUMP: return OP_CMPU_JUMP_NOFLAGS;
+    case OP_CMPF_JUMP: return OP_CMPF_JUMP_NOFLAGS;
+    case OP_INC_JMP: return OP_INC_JMP_NOFLAGS;
+    default: return cmd;
+    }
+}
+
+// Is a jump condition true for the comparison result (same checks as the TransCm commands).
+// The condition is the position of the jump in its group: e, g, l, ne, ge, le
+static bool jump_condition(int condition, bool is_float, bool equal, bool greater) noexcept
+{
+    switch (condition)
+    {
+    case 0: return equal;
+    case 1: return is_float ? !equal && greater : greater;
+    case 2: return !equal && !greater;
+    case 3: return !equal;
+    case 4: return greater || equal;
+    default: return !greater;
+    }
+}
+
+// Bit mask of the comparison results (see jump_mask_bit) for which the jump is taken
+static uint8_t jump_mask(uint8_t jump_cmd) noexcept
+{
+    int condition = (jump_cmd - OP_JE) / 3;
+    bool is_float = (jump_cmd - OP_JE) % 3 == 2;
+    uint8_t mask = 0;
+    for (int equal = 0; equal < 2; equal++)
+        for (int greater = 0; greater < 2; greater++)
+            if (jump_condition(condition, is_float, equal, greater))
+                mask |= 1 << jump_mask_bit(equal, greater);
+    return mask;
+}
+
+// Decoding a word into the record at the address
+DecodedCmd& DecodeCache::decode(uint16_t address, Word word, Word next, void* const* labels) noexcept
+{
+    DecodedCmd& rec = records[address];
+    used_pages |= uint64_t(1) << (address / (SIZE / 64));
+    rec.cmd = word.cmd3ops.cmd < OP_AMOUNT ? word.cmd3ops.cmd : OP_END; // Unknown codes stop the processor
+    for (int i = 0; i < 3; i++)
+        rec.regs[i] = word.cmd3ops.regs[i];
+    rec.adrs = word.cmd2ops.adrs;
+    rec.target = word.cmd2ops.adrs;
+
+    if (rec.cmd >= OP_JMP && rec.cmd <= OP_JLEF)
+    {
+        uint8_t code = word.cmd3ops.regs[0];
+        // Direct and relative jumps do not depend on the processor state
+        if (code != 1 && code != 2)
+        {
+            if (code != 0) rec.target = address + word.cmd2ops.adrs;
+            rec.regs[0] = 0;
+        }
+    }
+
+    // Pairs with a jump whose target is known when decoding are fused.
+    // The comparison and the jump must be of the same group (signed, unsigned, fractional)
+    uint8_t next_cmd = next.cmd3ops.cmd, next_code = next.cmd3ops.regs[0];
+    bool static_target = next_code != 1 && next_code != 2;
+    if (fusion && static_target)
+    {
+        uint16_t next_target = next_code == 0 ? next.cmd2ops.adrs : uint16_t(address + 2 + next.cmd2ops.adrs);
+        if (rec.cmd >= OP_CMP && rec.cmd <= OP_CMPF && next_cmd >= OP_JE && next_cmd <= OP_JLEF &&
+            (next_cmd - OP_JE) % 3 == rec.cmd - OP_CMP)
+        {
+            rec.cmd = OP_CMP_JUMP + (rec.cmd - OP_CMP);
+            rec.regs[2] = jump_mask(next_cmd);
+            rec.target = next_target;
+        }
+        else if (rec.cmd == OP_INC && next_cmd == OP_JMP)
+        {
+            rec.cmd = OP_INC_JMP;
+            rec.target = next_target;
+        }
+    }
+
+    // The flags written by a fused pair are read after its jump
+    uint16_t live = liveness.live_after(rec.cmd >= OP_CMP_JUMP ? uint16_t(address + 2) : address);
+    uint16_t written = FlagLiveness::written(word);
+    if (written != 0 && (written & live) == 0)
+        rec.cmd = without_flags(rec.cmd);
+
+    rec.handler = labels != nullptr ? labels[rec.cmd] : nullptr;
+    return rec;
+}
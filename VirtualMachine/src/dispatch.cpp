@@ -0,0 +1,554 @@
+#include "processor.h"
+#include <algorithm>
+
+// Direct-threaded run loop. Every instruction is executed in place instead of
+// calling the Command object, and each case jumps straight to the next one.
+// Instructions are taken from the DecodeCache, so the fields of a word are
+// extracted only once until the memory under it is written.
+// The semantics of every case repeat the matching Command from command.cpp.
+
+#if defined(__GNUC__)
+#define VM_THREADED_GOTO 1 // Labels as values (computed goto)
+#endif
+
+// Flags 2-7 and 12 are never deferred (see Processor::defer_flags), so the
+// comparisons, jumps and divisions access them in the flags directly.
+namespace
+{
+    // Setting a Flag Value
+    inline void put_flag(uint16_t& flags, uint8_t flag_index, bool is_true) noexcept
+    {
+        if (is_true) flags |= (1 << flag_index);
+        else flags &= ~(1 << flag_index);
+    }
+
+    // Getting the value of a flag
+    inline bool take_flag(uint16_t flags, uint8_t flag_index) noexcept
+    {
+        int16_t mask = 1 << flag_index;
+        return (flags & mask) != 0;
+    }
+}
+
+// Run loop with direct-threaded dispatch over the pre-decoded instructions
+void Processor::run_threaded(uint16_t start_address)
+{
+#ifdef VM_THREADED_GOTO
+    // Table of labels indexed by the operation code
+    static_assert(AMOUNT_COMMANDS == OP_AMOUNT, "Every operation code needs a label");
+    void* const labels[OP_DECODED_AMOUNT] = { &&op_end, &&op_jmp, &&op_je, &&op_jeu, &&op_jef,
+        &&op_jg, &&op_jgu, &&op_jgf, &&op_jl, &&op_jlu, &&op_jlf,
+        &&op_jne, &&op_jneu, &&op_jnef, &&op_jge, &&op_jgeu, &&op_jgef,
+        &&op_jle, &&op_jleu, &&op_jlef, &&op_print, &&op_printu, &&op_printf,
+        &&op_load, &&op_neg, &&op_negf, &&op_cmp, &&op_cmpu, &&op_cmpf, &&op_add,
+        &&op_addf, &&op_sub, &&op_subf, &&op_mul, &&op_mulf, &&op_divu, &&op_div,
+        &&op_divf, &&op_modu, &&op_mod, &&op_inc, &&op_dec, &&op_read, &&op_readu,
+        &&op_readf, &&op_and, &&op_or, &&op_xor, &&op_not, &&op_loadr, &&op_loadrv,
+        &&op_call, &&op_loadf, &&op_setf, &&op_endp,
+        &&op_cmp_jump, &&op_cmpu_jump, &&op_cmpf_jump, &&op_inc_jmp,
+        &&op_add_nf, &&op_sub_nf, &&op_mul_nf, &&op_addf_nf, &&op_subf_nf, &&op_mulf_nf,
+        &&op_and_nf, &&op_or_nf, &&op_xor_nf, &&op_not_nf, &&op_inc_nf, &&op_dec_nf,
+        &&op_cmp_jump_nf, &&op_cmpu_jump_nf, &&op_cmpf_jump_nf, &&op_inc_jmp_nf, &&op_skip };
+    // With --stats the instructions without flag updates go through op_count_flags first,
+    // so the handlers themselves count nothing
+    void* counted_labels[OP_DECODED_AMOUNT];
+    std::copy(labels, labels + OP_DECODED_AMOUNT, counted_labels);
+    for (int code = OP_ADD_NOFLAGS; code <= OP_SKIP; code++)
+        counted_labels[code] = &&op_count_flags;
+    void* const* handlers = count_flag_updates ? counted_labels : labels;
+    decoded.attach(&&op_decode);
+
+    #define VM_CASE(label, code) label:
+    #define VM_NEXT() do { cur = &decoded[pc]; goto *cur->handler; } while (0)
+#else
+    decoded.attach(nullptr);
+
+    #define VM_CASE(label, code) case code:
+    #define VM_NEXT() continue
+#endif
+    memory.watch(&decoded);
+    dead_flag_updates = decoded.analyze_flags(memory, start_address);
+
+    // Operands of the current instruction
+    #define R0 cur->regs[0]
+    #define R1 cur->regs[1]
+    #define R2 cur->regs[2]
+    // Value pointed to by an address register
+    #define REG(reg) memory.get_word(address_regs[reg])
+    #define SET_REG(reg, value) memory.set_word(address_regs[reg], value)
+    // Conditional jump: the target is calculated only if the condition holds
+    #define JUMP_IF(cond) pc = (cond) ? jump_target(cur) : uint16_t(pc + 2); VM_NEXT()
+
+    uint16_t pc = start_address; // Local copy of the Instruction Pointer
+    DecodedCmd* cur = nullptr;   // Current instruction
+    fused_executed = 0;
+    flag_updates_skipped = 0;
+
+    // The following word is needed to fuse instruction pairs
+    auto next_word = [this](uint16_t address) -> Word
+    {
+        return address + 3u < Memory::MEM_SIZE ? memory.get_word(address + 2) : Word();
+    };
+
+    // Searching for a new IP to transition to (TransCm::calc_instraction_pointer).
+    // Direct and relative targets were calculated when decoding.
+    auto jump_target = [this](const DecodedCmd* cmd) -> uint16_t
+    {
+        uint8_t code = cmd->regs[0];
+        if (code == 0) return cmd->target;
+        if (code == 1) return memory.get_word(cmd->adrs).uval;
+        return address_regs[cmd->regs[2]] + address_regs[cmd->regs[1]];
+    };
+
+#ifdef VM_THREADED_GOTO
+    VM_NEXT();
+
+op_decode:
+    decoded.decode(pc, memory.get_word(pc), next_word(pc), handlers);
+    goto *cur->handler;
+op_count_flags:
+    flag_updates_skipped++;
+    goto *labels[cur->cmd];
+#else
+    for (;;)
+    {
+    cur = &decoded[pc];
+    if (cur->cmd == DecodeCache::NOT_DECODED)
+        decoded.decode(pc, memory.get_word(pc), next_word(pc), nullptr);
+    if (count_flag_updates && cur->cmd >= OP_ADD_NOFLAGS) flag_updates_skipped++;
+    switch (cur->cmd)
+    {
+    default:
+#endif
+
+    VM_CASE(op_end, OP_END)
+        ip = pc;
+        return;
+
+    // --- Jumps ---
+    VM_CASE(op_jmp, OP_JMP)
+        pc = jump_target(cur);
+        VM_NEXT();
+    VM_CASE(op_je, OP_JE)     JUMP_IF(take_flag(flags, 2));
+    VM_CASE(op_jeu, OP_JEU)   JUMP_IF(take_flag(flags, 4));
+    VM_CASE(op_jef, OP_JEF)   JUMP_IF(take_flag(flags, 6));
+    VM_CASE(op_jg, OP_JG)     JUMP_IF(take_flag(flags, 3));
+    VM_CASE(op_jgu, OP_JGU)   JUMP_IF(take_flag(flags, 5));
+    VM_CASE(op_jgf, OP_JGF)   JUMP_IF(!take_flag(flags, 6) && take_flag(flags, 7));
+    VM_CASE(op_jl, OP_JL)     JUMP_IF(!take_flag(flags, 2) && !take_flag(flags, 3));
+    VM_CASE(op_jlu, OP_JLU)   JUMP_IF(!take_flag(flags, 4) && !take_flag(flags, 5));
+    VM_CASE(op_jlf, OP_JLF)   JUMP_IF(!take_flag(flags, 6) && !take_flag(flags, 7));
+    VM_CASE(op_jne, OP_JNE)   JUMP_IF(!take_flag(flags, 2));
+    VM_CASE(op_jneu, OP_JNEU) JUMP_IF(!take_flag(flags, 4));
+    VM_CASE(op_jnef, OP_JNEF) JUMP_IF(!take_flag(flags, 6));
+    VM_CASE(op_jge, OP_JGE)   JUMP_IF(take_flag(flags, 3) || take_flag(flags, 2));
+    VM_CASE(op_jgeu, OP_JGEU) JUMP_IF(take_flag(flags, 5) || take_flag(flags, 4));
+    VM_CASE(op_jgef, OP_JGEF) JUMP_IF(take_flag(flags, 6) || take_flag(flags, 7));
+    VM_CASE(op_jle, OP_JLE)   JUMP_IF(!take_flag(flags, 3));
+    VM_CASE(op_jleu, OP_JLEU) JUMP_IF(!take_flag(flags, 5));
+    VM_CASE(op_jlef, OP_JLEF) JUMP_IF(!take_flag(flags, 7));
+
+    // --- Printing ---
+    VM_CASE(op_print, OP_PRINT)
+        printer.print(REG(R2).ival);
+        pc += 2; VM_NEXT();
+    VM_CASE(op_printu, OP_PRINTU)
+        printer.print(REG(R2).uval);
+        pc += 2; VM_NEXT();
+    VM_CASE(op_printf, OP_PRINTF)
+        printer.print(REG(R2).fval);
+        pc += 2; VM_NEXT();
+
+    VM_CASE(op_load, OP_LOAD)
+        address_regs[R0] = cur->adrs;
+        pc += 2; VM_NEXT();
+
+    // --- Arithmetic ---
+    VM_CASE(op_neg, OP_NEG)
+    {
+        Word res = Word();
+        res.ival = -REG(R2).ival;
+        defer_flags(FlagsOp::Int, res);
+        SET_REG(R2, res);
+        pc += 2; VM_NEXT();
+    }
+    VM_CASE(op_negf, OP_NEGF)
+    {
+        Word res = Word();
+        res.fval = -REG(R2).fval;
+        defer_flags(FlagsOp::Float, res);
+        SET_REG(R2, res);
+        pc += 2; VM_NEXT();
+    }
+
+    // --- Comparisons ---
+    VM_CASE(op_cmp, OP_CMP)
+    {
+        Word val1 = REG(R0), val2 = REG(R1);
+        put_flag(flags, 2, val1.ival == val2.ival);
+        put_flag(flags, 3, val1.ival > val2.ival);
+        pc += 2; VM_NEXT();
+    }
+    VM_CASE(op_cmpu, OP_CMPU)
+    {
+        Word val1 = REG(R0), val2 = REG(R1);
+        put_flag(flags, 4, val1.uval == val2.uval);
+        put_flag(flags, 5, val1.uval > val2.uval);
+        pc += 2; VM_NEXT();
+    }
+    VM_CASE(op_cmpf, OP_CMPF)
+    {
+        Word val1 = REG(R0), val2 = REG(R1);
+        put_flag(flags, 6, val1.fval == val2.fval);
+        put_flag(flags, 7, val1.fval > val2.fval);
+        pc += 2; VM_NEXT();
+    }
+
+    VM_CASE(op_add, OP_ADD)
+    {
+        Word word1 = REG(R1), word2 = REG(R2), res = Word();
+        res.uval = word1.uval + word2.uval;
+        defer_flags(FlagsOp::AddInt, res, word1, word2);
+        SET_REG(R0, res);
+        pc += 2; VM_NEXT();
+    }
+    VM_CASE(op_addf, OP_ADDF)
+    {
+        Word word1 = REG(R1), word2 = REG(R2), res = add_float(word1, word2);
+        defer_flags(FlagsOp::AddFloat, res, word1, word2);
+        SET_REG(R0, res);
+        pc += 2; VM_NEXT();
+    }
+    VM_CASE(op_sub, OP_SUB)
+    {
+        Word word1 = REG(R1), word2 = REG(R2), res = Word();
+        res.uval = word1.uval - word2.uval;
+        defer_flags(FlagsOp::SubInt, res, word1, word2);
+        SET_REG(R0, res);
+        pc += 2; VM_NEXT();
+    }
+    VM_CASE(op_subf, OP_SUBF)
+    {
+        Word word1 = REG(R1), word2 = REG(R2);
+        word2.uval ^= 0x80000000u; // Negation through the sign bit, as in SubFCm
+        Word res = add_float(word1, word2);
+        defer_flags(FlagsOp::AddFloat, res, word1, word2);
+        SET_REG(R0, res);
+        pc += 2; VM_NEXT();
+    }
+    VM_CASE(op_mul, OP_MUL)
+    {
+        Word word1 = REG(R1), word2 = REG(R2), res = Word();
+        res.uval = word1.uval * word2.uval;
+        defer_flags(FlagsOp::MulInt, res, word1, word2);
+        SET_REG(R0, res);
+        pc += 2; VM_NEXT();
+    }
+    VM_CASE(op_mulf, OP_MULF)
+    {
+        Word word1 = REG(R1), word2 = REG(R2), res = mul_float(word1, word2);
+        defer_flags(FlagsOp::MulFloat, res, word1, word2);
+        SET_REG(R0, res);
+        pc += 2; VM_NEXT();
+    }
+    VM_CASE(op_divu, OP_DIVU)
+    {
+        Word res = Word(), divider = REG(R2);
+        put_flag(flags, 12, divider.uval == 0); // Flag indicating division by zero
+        res.uval = REG(R1).uval / divider.uval;
+        defer_flags(FlagsOp::Int, res);
+        SET_REG(R0, res);
+        pc += 2; VM_NEXT();
+    }
+    VM_CASE(op_div, OP_DIV)
+    {
+        Word res = Word(), divider = REG(R2);
+        put_flag(flags, 12, divider.ival == 0);
+        res.ival = REG(R1).ival / divider.ival;
+        defer_flags(FlagsOp::Int, res);
+        SET_REG(R0, res);
+        pc += 2; VM_NEXT();
+    }
+    VM_CASE(op_divf, OP_DIVF)
+    {
+        Word res = Word(), divider = REG(R2);
+        put_flag(flags, 12, divider.fval == 0);
+        res.fval = REG(R1).fval / divider.fval;
+        defer_flags(FlagsOp::Float, res);
+        SET_REG(R0, res);
+        pc += 2; VM_NEXT();
+    }
+    VM_CASE(op_modu, OP_MODU)
+    {
+        Word res = Word(), divider = REG(R2);
+        put_flag(flags, 12, divider.uval == 0);
+        res.uval = REG(R1).uval % divider.uval;
+        defer_flags(FlagsOp::Int, res);
+        SET_REG(R0, res);
+        pc += 2; VM_NEXT();
+    }
+    VM_CASE(op_mod, OP_MOD)
+    {
+        Word res = Word(), divider = REG(R2);
+        put_flag(flags, 12, divider.ival == 0);
+        res.ival = REG(R1).ival % divider.ival;
+        defer_flags(FlagsOp::Int, res);
+        SET_REG(R0, res);
+        pc += 2; VM_NEXT();
+    }
+    VM_CASE(op_inc, OP_INC)
+    {
+        Word word1 = REG(R2), sum_result = Word();
+        sum_result.uval = word1.uval + 1;
+        set_flag(9, sum_result.ival < word1.ival);
+        set_flag(10, sum_result.uval < word1.uval);
+        SET_REG(R2, sum_result);
+        pc += 2; VM_NEXT();
+    }
+    VM_CASE(op_dec, OP_DEC)
+    {
+        Word word1 = REG(R2), sub_result = Word();
+        sub_result.uval = word1.uval - 1;
+        set_flag(9, sub_result.ival > word1.ival);
+        set_flag(10, sub_result.uval > word1.uval);
+        SET_REG(R2, sub_result);
+        pc += 2; VM_NEXT();
+    }
+
+    // --- Reading ---
+    VM_CASE(op_read, OP_READ)
+    {
+        Word user_val = Word();
+        user_val.ival = reader.read_int();
+        SET_REG(R2, user_val);
+        pc += 2; VM_NEXT();
+    }
+    VM_CASE(op_readu, OP_READU)
+    {
+        Word user_val = Word();
+        user_val.uval = reader.read_uint();
+        SET_REG(R2, user_val);
+        pc += 2; VM_NEXT();
+    }
+    VM_CASE(op_readf, OP_READF)
+    {
+        Word user_val = Word();
+        user_val.fval = reader.read_float();
+        SET_REG(R2, user_val);
+        pc += 2; VM_NEXT();
+    }
+
+    // --- Bitwise operations ---
+    VM_CASE(op_and, OP_AND)
+    {
+        Word res = Word();
+        res.uval = REG(R1).uval & REG(R2).uval;
+        SET_REG(R0, res);
+        defer_flags(FlagsOp::Int, res);
+        pc += 2; VM_NEXT();
+    }
+    VM_CASE(op_or, OP_OR)
+    {
+        Word res = Word();
+        res.uval = REG(R1).uval | REG(R2).uval;
+        SET_REG(R0, res);
+        defer_flags(FlagsOp::Int, res);
+        pc += 2; VM_NEXT();
+    }
+    VM_CASE(op_xor, OP_XOR)
+    {
+        Word res = Word();
+        res.uval = REG(R1).uval ^ REG(R2).uval;
+        SET_REG(R0, res);
+        defer_flags(FlagsOp::Int, res);
+        pc += 2; VM_NEXT();
+    }
+    VM_CASE(op_not, OP_NOT)
+    {
+        Word res = Word();
+        res.uval = ~REG(R2).uval;
+        SET_REG(R0, res);
+        defer_flags(FlagsOp::Int, res);
+        pc += 2; VM_NEXT();
+    }
+
+    // --- Registers and flags ---
+    VM_CASE(op_loadr, OP_LOADR)
+        address_regs[R0] = address_regs[R1];
+        pc += 2; VM_NEXT();
+    VM_CASE(op_loadrv, OP_LOADRV)
+        SET_REG(R0, REG(R1));
+        pc += 2; VM_NEXT();
+    VM_CASE(op_loadf, OP_LOADF)
+    {
+        Word val = Word();
+        val.uval = int(get_flag(R1));
+        SET_REG(R0, val);
+        pc += 2; VM_NEXT();
+    }
+    VM_CASE(op_setf, OP_SETF)
+        set_flag(R0, REG(R1).uval != 0);
+        pc += 2; VM_NEXT();
+
+    // --- Subroutines ---
+    VM_CASE(op_call, OP_CALL)
+        push(pc + 2); // Storing the return address onto a register-mimicking stack
+        pc = cur->target;
+        VM_NEXT();
+    VM_CASE(op_endp, OP_ENDP)
+        pc = pop();
+        VM_NEXT();
+
+    // --- Fused instruction pairs ---
+    // Comparison and conditional jump. The comparison flags are still written for
+    // later instructions, but the jump takes the result directly.
+    VM_CASE(op_cmp_jump, OP_CMP_JUMP)
+    {
+        Word val1 = REG(R0), val2 = REG(R1);
+        bool equal = val1.ival == val2.ival, greater = val1.ival > val2.ival;
+        put_flag(flags, 2, equal);
+        put_flag(flags, 3, greater);
+        fused_executed++;
+        pc = (R2 >> jump_mask_bit(equal, greater)) & 1 ? cur->target : uint16_t(pc + 4);
+        VM_NEXT();
+    }
+    VM_CASE(op_cmpu_jump, OP_CMPU_JUMP)
+    {
+        Word val1 = REG(R0), val2 = REG(R1);
+        bool equal = val1.uval == val2.uval, greater = val1.uval > val2.uval;
+        put_flag(flags, 4, equal);
+        put_flag(flags, 5, greater);
+        fused_executed++;
+        pc = (R2 >> jump_mask_bit(equal, greater)) & 1 ? cur->target : uint16_t(pc + 4);
+        VM_NEXT();
+    }
+    VM_CASE(op_cmpf_jump, OP_CMPF_JUMP)
+    {
+        Word val1 = REG(R0), val2 = REG(R1);
+        bool equal = val1.fval == val2.fval, greater = val1.fval > val2.fval;
+        put_flag(flags, 6, equal);
+        put_flag(flags, 7, greater);
+        fused_executed++;
+        pc = (R2 >> jump_mask_bit(equal, greater)) & 1 ? cur->target : uint16_t(pc + 4);
+        VM_NEXT();
+    }
+    // Increment and jump (end of a counting loop)
+    VM_CASE(op_inc_jmp, OP_INC_JMP)
+    {
+        Word word1 = REG(R2), sum_result = Word();
+        sum_result.uval = word1.uval + 1;
+        set_flag(9, sum_result.ival < word1.ival);
+        set_flag(10, sum_result.uval < word1.uval);
+        SET_REG(R2, sum_result);
+        // If the write replaced the jump, the following word is executed as usual
+        if (cur->cmd == OP_INC_JMP)
+        {
+            fused_executed++;
+            pc = cur->target;
+        }
+        else pc += 2;
+        VM_NEXT();
+    }
+
+    // --- Instructions whose flag updates are never read ---
+    #define BINARY_NOFLAGS(field, op) { Word res = Word(); res.field = REG(R1).field op REG(R2).field; \
+        SET_REG(R0, res); pc += 2; VM_NEXT(); }
+    VM_CASE(op_add_nf, OP_ADD_NOFLAGS)  BINARY_NOFLAGS(uval, +)
+    VM_CASE(op_sub_nf, OP_SUB_NOFLAGS)  BINARY_NOFLAGS(uval, -)
+    VM_CASE(op_mul_nf, OP_MUL_NOFLAGS)  BINARY_NOFLAGS(uval, *)
+    VM_CASE(op_addf_nf, OP_ADDF_NOFLAGS)
+    {
+        Word word1 = REG(R1), word2 = REG(R2), res = add_float(word1, word2);
+        SET_REG(R0, res);
+        pc += 2; VM_NEXT();
+    }
+    VM_CASE(op_subf_nf, OP_SUBF_NOFLAGS)
+    {
+        Word word1 = REG(R1), word2 = REG(R2);
+        word2.uval ^= 0x80000000u;
+        Word res = add_float(word1, word2);
+        SET_REG(R0, res);
+        pc += 2; VM_NEXT();
+    }
+    VM_CASE(op_mulf_nf, OP_MULF_NOFLAGS)
+    {
+        Word word1 = REG(R1), word2 = REG(R2), res = mul_float(word1, word2);
+        SET_REG(R0, res);
+        pc += 2; VM_NEXT();
+    }
+    VM_CASE(op_and_nf, OP_AND_NOFLAGS)  BINARY_NOFLAGS(uval, &)
+    VM_CASE(op_or_nf, OP_OR_NOFLAGS)    BINARY_NOFLAGS(uval, |)
+    VM_CASE(op_xor_nf, OP_XOR_NOFLAGS)  BINARY_NOFLAGS(uval, ^)
+    #undef BINARY_NOFLAGS
+    VM_CASE(op_not_nf, OP_NOT_NOFLAGS)
+    {
+        Word res = Word();
+        res.uval = ~REG(R2).uval;
+        SET_REG(R0, res);
+        pc += 2; VM_NEXT();
+    }
+    VM_CASE(op_inc_nf, OP_INC_NOFLAGS)
+    {
+        Word res = REG(R2);
+        res.uval++;
+        SET_REG(R2, res);
+        pc += 2; VM_NEXT();
+    }
+    VM_CASE(op_dec_nf, OP_DEC_NOFLAGS)
+    {
+        Word res = REG(R2);
+        res.uval--;
+        SET_REG(R2, res);
+        pc += 2; VM_NEXT();
+    }
+    VM_CASE(op_cmp_jump_nf, OP_CMP_JUMP_NOFLAGS)
+    {
+        Word val1 = REG(R0), val2 = REG(R1);
+        fused_executed++;
+        pc = (R2 >> jump_mask_bit(val1.ival == val2.ival, val1.ival > val2.ival)) & 1 ? cur->target : uint16_t(pc + 4);
+        VM_NEXT();
+    }
+    VM_CASE(op_cmpu_jump_nf, OP_CMPU_JUMP_NOFLAGS)
+    {
+        Word val1 = REG(R0), val2 = REG(R1);
+        fused_executed++;
+        pc = (R2 >> jump_mask_bit(val1.uval == val2.uval, val1.uval > val2.uval)) & 1 ? cur->target : uint16_t(pc + 4);
+        VM_NEXT();
+    }
+    VM_CASE(op_cmpf_jump_nf, OP_CMPF_JUMP_NOFLAGS)
+    {
+        Word val1 = REG(R0), val2 = REG(R1);
+        fused_executed++;
+        pc = (R2 >> jump_mask_bit(val1.fval == val2.fval, val1.fval > val2.fval)) & 1 ? cur->target : uint16_t(pc + 4);
+        VM_NEXT();
+    }
+    VM_CASE(op_inc_jmp_nf, OP_INC_JMP_NOFLAGS)
+    {
+        Word res = REG(R2);
+        res.uval++;
+        SET_REG(R2, res);
+        if (cur->cmd == OP_INC_JMP_NOFLAGS)
+        {
+            fused_executed++;
+            pc = cur->target;
+        }
+        else pc += 2;
+        VM_NEXT();
+    }
+    VM_CASE(op_skip, OP_SKIP)
+        pc += 2; VM_NEXT();
+
+#ifndef VM_THREADED_GOTO
+    }
+    }
+#endif
+
+    #undef JUMP_IF
+    #undef SET_REG
+    #undef REG
+    #undef R2
+    #undef R1
+    #undef R0
+    #undef VM_NEXT
+    #undef VM_CASE
+}
@@ -0,0 +1,194 @@
+#include "flow.h"
+#include "memory.h"
+#include <vector>
+
+// The graph is built from the same targets as TransCm::calc_instraction_pointer:
+// direct and relative jumps have known targets, jumps through memory and through
+// registers can go anywhere. A call continues at the subroutine, its return address
+// is reached from endp, whose target is unknown. Every flag is live before an
+// unknown target, and none is live after the end of the program.
+
+namespace
+{
+    constexpr uint16_t flag_bit(int flag) { return uint16_t(1 << flag); }
+
+    constexpr uint16_t FLAGS_INT = flag_bit(0) | flag_bit(1) | flag_bit(8); // Command::set_flags_int
+    constexpr uint16_t FLAGS_FLOAT = flag_bit(0) | flag_bit(8);             // Command::set_flags_float
+    constexpr uint16_t FLAGS_OVERFLOW = flag_bit(9) | flag_bit(10);
+    constexpr uint16_t FLAG_FLOAT_OVERFLOW = flag_bit(11);
+    constexpr uint16_t FLAG_DIV_ZERO = flag_bit(12);
+
+    // Equality and "greater" flags of the comparison group (signed, unsigned, fractional)
+    constexpr uint16_t compare_flags(int group) { return flag_bit(2 + group * 2) | flag_bit(3 + group * 2); }
+
+    // Instruction of the control flow graph
+    struct Node
+    {
+        uint16_t address;  // Address of the instruction
+        uint8_t cmd;       // Operation code
+        uint16_t next[2];  // Known successors
+        uint8_t count;     // Number of known successors
+        bool unknown;      // Can the instruction go to an unknown address
+        uint16_t reads;    // Flags read by the instruction
+        uint16_t writes;   // Flags written by the instruction
+        uint16_t live_in;  // Flags live before the instruction
+        uint16_t live_out; // Flags live after the instruction
+    };
+}
+
+FlagLiveness::~FlagLiveness()
+{
+    delete[] live_out;
+    delete[] code;
+    delete[] index;
+}
+
+// Flags written by an instruction
+uint16_t FlagLiveness::written(Word word) noexcept
+{
+    switch (word.cmd3ops.cmd)
+    {
+    case OP_NEG: case OP_AND: case OP_OR: case OP_XOR: case OP_NOT:
+        return FLAGS_INT;
+    case OP_DIVU: case OP_DIV: case OP_MODU: case OP_MOD:
+        return FLAGS_INT | FLAG_DIV_ZERO;
+    case OP_NEGF:
+        return FLAGS_FLOAT;
+    case OP_DIVF:
+        return FLAGS_FLOAT | FLAG_DIV_ZERO;
+    case OP_ADD: case OP_SUB: case OP_MUL:
+        return FLAGS_INT | FLAGS_OVERFLOW;
+    case OP_ADDF: case OP_SUBF: case OP_MULF:
+        return FLAGS_FLOAT | FLAG_FLOAT_OVERFLOW;
+    case OP_CMP: case OP_CMPU: case OP_CMPF:
+        return compare_flags(word.cmd3ops.cmd - OP_CMP);
+    case OP_INC: case OP_DEC:
+        return FLAGS_OVERFLOW;
+    case OP_SETF:
+        return word.cmd3ops.regs[0] < 16 ? flag_bit(word.cmd3ops.regs[0]) : 0;
+    default:
+        return 0;
+    }
+}
+
+// Flags read by an instruction
+uint16_t FlagLiveness::read(Word word) noexcept
+{
+    uint8_t cmd = word.cmd3ops.cmd;
+    if (cmd >= OP_JE && cmd <= OP_JLEF)
+        return compare_flags((cmd - OP_JE) % 3);
+    if (cmd == OP_LOADF)
+        return word.cmd3ops.regs[1] < 16 ? flag_bit(word.cmd3ops.regs[1]) : 0;
+    return 0;
+}
+
+// Forgetting the results when the analysed code is changed.
+// Only the entries of the analysed instructions are restored
+void FlagLiveness::discard() noexcept
+{
+    active = false;
+    for (uint16_t address : analysed)
+    {
+        live_out[address] = ALL_FLAGS;
+        code[address] = 0;
+        code[uint16_t(address + 1)] = 0;
+        index[address] = -1;
+    }
+    analysed.clear();
+}
+
+// Analysing the program in the memory that starts at the address
+uint32_t FlagLiveness::analyze(const Memory& memory, uint16_t start)
+{
+    if (live_out == nullptr)
+    {
+        live_out = new uint16_t[SIZE];
+        code = new uint8_t[SIZE]();
+        index = new int32_t[SIZE];
+        for (uint32_t i = 0; i < SIZE; i++)
+        {
+            live_out[i] = ALL_FLAGS;
+            index[i] = -1;
+        }
+    }
+    discard();
+
+    // Finding the instructions reachable from the start
+    std::vector<Node> nodes;
+    std::vector<uint16_t> pending(1, start);
+    while (!pending.empty())
+    {
+        uint16_t address = pending.back();
+        pending.pop_back();
+        if (index[address] >= 0 || address + 1u >= Memory::MEM_SIZE) continue; // Addresses outside the memory stay unknown
+
+        Word word = memory.get_word(address);
+        uint8_t cmd = word.cmd3ops.cmd;
+
+        Node node = Node();
+        node.address = address;
+        node.cmd = cmd;
+        node.reads = read(word);
+        node.writes = written(word);
+        if (cmd == OP_END || cmd >= OP_AMOUNT) {} // The processor stops
+        else if (cmd <= OP_JLEF)
+        {
+            uint8_t type = word.cmd3ops.regs[0];
+            if (type == 1 || type == 2) node.unknown = true;
+            else node.next[node.count++] = type == 0 ? word.cmd2ops.adrs : uint16_t(address + word.cmd2ops.adrs);
+            if (cmd != OP_JMP) node.next[node.count++] = address + 2;
+        }
+        else if (cmd == OP_CALL)
+        {
+            node.next[node.count++] = word.cmd2ops.adrs;
+            pending.push_back(address + 2); // Return address
+        }
+        else if (cmd == OP_ENDP) node.unknown = true;
+        else node.next[node.count++] = address + 2;
+
+        index[address] = int32_t(nodes.size());
+        analysed.push_back(address);
+        nodes.push_back(node);
+        for (int i = 0; i < node.count; i++)
+            pending.push_back(node.next[i]);
+    }
+
+    // Growing the live flags until nothing changes. Nodes were found in depth-first
+    // order, so going backwards moves the flags against the control flow
+    bool changed = true;
+    while (changed)
+    {
+        changed = false;
+        for (size_t i = nodes.size(); i-- > 0; )
+        {
+            Node& node = nodes[i];
+            uint16_t out = node.unknown ? ALL_FLAGS : 0;
+            for (int k = 0; k < node.count; k++)
+            {
+                int32_t next = index[node.next[k]];
+                out |= next >= 0 ? nodes[next].live_in : ALL_FLAGS;
+            }
+            uint16_t in = node.reads | (out & ~node.writes);
+            if (out != node.live_out || in != node.live_in)
+            {
+                node.live_out = out;
+                node.live_in = in;
+                changed = true;
+            }
+        }
+    }
+
+    uint32_t dead = 0;
+    for (size_t i = 0; i < nodes.size(); i++)
+    {
+        uint16_t address = nodes[i].address;
+        live_out[address] = nodes[i].live_out;
+        code[address] = 1;
+        code[uint16_t(address + 1)] = 1;
+        // Setting a flag explicitly is not a calculation
+        if (nodes[i].cmd != OP_SETF && nodes[i].writes != 0 && (nodes[i].writes & nodes[i].live_out) == 0)
+            dead++;
+    }
+    active = true;
+    return dead;
+}
@@ -0,0 +1,34 @@
+#include "image.h"
+#include "processor.h"
+#include <cstring>
+
+// Checking the image and copying its segments into memory
+ImageStatus load_image(Processor& cpu, const char* data, size_t size, uint16_t& run_address) noexcept
+{
+    ImageHeader header;
+    if (size < sizeof(header)) return ImageStatus::NotImage;
+    std::memcpy(&header, data, sizeof(header));
+    if (std::memcmp(header.magic, "VM9I", 4) != 0) return ImageStatus::NotImage;
+    if (header.version != IMAGE_VERSION) return ImageStatus::Invalid;
+
+    // Every segment is checked before anything is copied
+    for (int pass = 0; pass < 2; pass++)
+    {
+        size_t offset = sizeof(header);
+        for (uint16_t i = 0; i < header.segments; i++)
+        {
+            ImageSegment segment;
+            if (size - offset < sizeof(segment)) return ImageStatus::Invalid;
+            std::memcpy(&segment, data + offset, sizeof(segment));
+            offset += sizeof(segment);
+            size_t bytes = size_t(segment.words) * sizeof(Word);
+            if (size - offset < bytes || segment.address + 2u * segment.words > Memory::MEM_SIZE)
+                return ImageStatus::Invalid;
+            if (pass == 1)
+                cpu.memory.load_words(segment.address, reinterpret_cast<const Word*>(data + offset), segment.words);
+            offset += bytes;
+        }
+    }
+    run_address = header.entry;
+    return ImageStatus::Loaded;
+}
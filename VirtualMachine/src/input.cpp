@@ -0,0 +1,185 @@
+#include "input.h"
+#include "output.h"
+#include <algorithm>
+#include <charconv>
+#include <limits>
+#include <cstring>
+
+namespace
+{
+    bool is_space(char c) { return c == ' ' || (c >= '\t' && c <= '\r'); }
+    bool is_digit(char c) { return c >= '0' && c <= '9'; }
+}
+
+InputChannel::~InputChannel()
+{
+    close();
+}
+
+// Taking the whole file as the input. A file is mapped into memory,
+// the standard input is read into a buffer
+bool InputChannel::open(const char* path, Mode bulk_mode)
+{
+    close();
+    if (std::strcmp(path, "-") == 0) file.read(std::cin);
+    else if (!file.open(path)) return false;
+
+    pos = file.data();
+    end = pos + file.size();
+    mode = bulk_mode;
+    failed = false;
+    return true;
+}
+
+// Returning to the stream mode
+void InputChannel::close() noexcept
+{
+    file.close();
+    pos = end = nullptr;
+    failed = false;
+    mode = Mode::Stream;
+}
+
+// Reading the sign and the digits of an integer. The magnitude stops growing above 2^32
+bool InputChannel::read_integer(bool& negative, uint64_t& magnitude) noexcept
+{
+    if (!start_number(negative) || !is_digit(*pos))
+    {
+        failed = true;
+        return false;
+    }
+    magnitude = 0;
+    for (; pos < end && is_digit(*pos); pos++)
+        if (magnitude <= std::numeric_limits<uint32_t>::max()) magnitude = magnitude * 10 + uint64_t(*pos - '0');
+    return true;
+}
+
+// Skipping the spaces and the sign. Returns false if the input has failed or ended
+bool InputChannel::start_number(bool& negative) noexcept
+{
+    if (failed) return false;
+    while (pos < end && is_space(*pos)) pos++;
+    negative = false;
+    if (pos < end && (*pos == '-' || *pos == '+'))
+    {
+        negative = *pos == '-';
+        pos++;
+    }
+    return pos < end;
+}
+
+// Next raw word of the binary mode
+uint32_t InputChannel::next_word() noexcept
+{
+    if (failed || end - pos < 4)
+    {
+        failed = true;
+        return 0;
+    }
+    uint32_t word;
+    std::memcpy(&word, pos, 4);
+    pos += 4;
+    return word;
+}
+
+// The numbers outside the range are limited to it and stop the input, and the
+// unsigned ones with a minus are negated modulo 2^32, as the stream extraction does
+int32_t InputChannel::read_int() noexcept
+{
+    if (mode == Mode::Binary) return int32_t(next_word());
+    if (mode == Mode::Stream)
+    {
+        if (tied) tied->before_read();
+        int32_t value = 0;
+        *source >> value;
+        return value;
+    }
+
+    bool negative;
+    uint64_t magnitude;
+    if (!read_integer(negative, magnitude)) return 0;
+    uint64_t limit = negative ? uint64_t(1) << 31 : uint64_t(std::numeric_limits<int32_t>::max());
+    if (magnitude > limit)
+    {
+        failed = true;
+        return negative ? std::numeric_limits<int32_t>::min() : std::numeric_limits<int32_t>::max();
+    }
+    return negative ? int32_t(-int64_t(magnitude)) : int32_t(magnitude);
+}
+
+uint32_t InputChannel::read_uint() noexcept
+{
+    if (mode == Mode::Binary) return next_word();
+    if (mode == Mode::Stream)
+    {
+        if (tied) tied->before_read();
+        uint32_t value = 0;
+        *source >> value;
+        return value;
+    }
+
+    bool negative;
+    uint64_t magnitude;
+    if (!read_integer(negative, magnitude)) return 0;
+    if (magnitude > std::numeric_limits<uint32_t>::max())
+    {
+        failed = true;
+        return std::numeric_limits<uint32_t>::max();
+    }
+    return negative ? uint32_t(0 - magnitude) : uint32_t(magnitude);
+}
+
+// Fractional numbers are parsed by std::from_chars. Like the stream extraction,
+// it does not take the words "inf" and "nan", and a number outside the range stops the input
+float InputChannel::read_float() noexcept
+{
+    if (mode == Mode::Binary)
+    {
+        Word word;
+        word.uval = next_word();
+        return word.fval;
+    }
+    if (mode == Mode::Stream)
+    {
+        if (tied) tied->before_read();
+        float value = 0;
+        *source >> value;
+        return value;
+    }
+
+    bool negative;
+    float value = 0;
+    if (!start_number(negative) || !(is_digit(*pos) || *pos == '.'))
+    {
+        failed = true;
+        return 0;
+    }
+    const char* start = pos;
+    std::from_chars_result result = std::from_chars(pos, end, value, std::chars_format::general);
+    pos = result.ptr;
+    const char* exponent = std::find_if(start, pos, [](char c) { return c == 'e' || c == 'E'; });
+    // The stream also takes an exponent letter without digits ("1e", "1e+") and fails.
+    // A letter after a complete exponent ("1e5e5") is left for the next read
+    if (result.ec == std::errc::invalid_argument || (exponent == pos && pos < end && (*pos == 'e' || *pos == 'E')))
+    {
+        failed = true;
+        return 0;
+    }
+    if (result.ec == std::errc::result_out_of_range)
+    {
+        // Too small numbers are rounded to a subnormal float or zero, too large ones
+        // become the largest float and stop the input
+        if (exponent + 1 < pos && exponent[1] == '-')
+        {
+            double small = 0;
+            std::from_chars(start, pos, small, std::chars_format::general);
+            value = float(small);
+        }
+        else
+        {
+            failed = true;
+            value = std::numeric_limits<float>::max();
+        }
+    }
+    return negative ? -value : value;
+}
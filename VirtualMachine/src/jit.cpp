@@ -0,0 +1,588 @@
+#include "jit.h"
+#include "processor.h"
+
+#include <cstddef>
+#include <cstring>
+#include <vector>
+
+#if defined(__x86_64__) && defined(__linux__)
+#define VM_JIT_X86_64 1
+#include <sys/mman.h>
+#endif
+
+// Run loop with the JIT. Cold code is executed by the Command objects one
+// instruction at a time. Entries to block starts are counted, and a block that
+// becomes hot is compiled and called directly from then on.
+void Processor::run_jit(uint16_t start_address)
+{
+    if (!jit.prepare(*this))
+    {
+        std::cerr << "JIT is not supported on this platform.\n";
+        run_threaded(start_address);
+        return;
+    }
+    // Records of the compiled instructions report writes into the compiled code
+    decoded.attach(nullptr);
+    memory.watch(&decoded);
+
+    ip = start_address;
+    bool block_start = true;
+    for (;;)
+    {
+        if (decoded.code_written) jit.flush();
+
+        if (block_start)
+        {
+            Jit::Block block = jit.find(ip);
+            if (block == nullptr && jit.hot(ip) && jit.compile(ip))
+                block = jit.find(ip);
+            if (block != nullptr)
+            {
+                sync_flags(); // Compiled code works with the flags directly
+                ip = block(&jit.context);
+                continue;
+            }
+        }
+
+        Word word = memory.get_word(ip);
+        uint8_t cmd = word.cmd3ops.cmd;
+        if (cmd == OP_END || cmd >= OP_AMOUNT) break;
+
+        (*commands[cmd])(word, *this); // Run CPU command
+        if (cmd > OP_JLEF) ip += 2;
+
+        // Blocks start after transitions and after the instructions that stop a block
+        block_start = cmd <= OP_JLEF || cmd == OP_CALL || cmd == OP_ENDP || (cmd >= OP_READ && cmd <= OP_READF);
+    }
+}
+
+Jit::~Jit()
+{
+    delete[] blocks;
+    delete[] counters;
+    delete[] code_cells;
+#ifdef VM_JIT_X86_64
+    if (code != nullptr) munmap(code, CODE_SIZE);
+#endif
+}
+
+// Can the JIT work on this platform
+bool Jit::supported() noexcept
+{
+#ifdef VM_JIT_X86_64
+    return true;
+#else
+    return false;
+#endif
+}
+
+void Jit::set_threshold(uint16_t executions) noexcept
+{
+    threshold = executions < NEVER ? executions : NEVER - 1;
+}
+
+// Counting an entry to the address. True when the block has become hot
+bool Jit::hot(uint16_t address) noexcept
+{
+    if (counters[address] == NEVER) return false;
+    used_pages |= page_bit(address);
+    return ++counters[address] >= threshold;
+}
+
+// Discarding all compiled blocks
+void Jit::flush() noexcept
+{
+    if (blocks == nullptr) return;
+    // Only the pages with counted or compiled addresses are visited
+    constexpr uint32_t PAGE_SIZE = DecodeCache::SIZE / 64;
+    for (uint32_t page = 0; page < 64; page++)
+    {
+        if (!(used_pages & (uint64_t(1) << page))) continue;
+        for (uint32_t i = page * PAGE_SIZE; i < (page + 1) * PAGE_SIZE; i++)
+        {
+            blocks[i] = nullptr;
+            counters[i] = 0;
+            code_cells[i] = 0;
+        }
+    }
+    used_pages = 0;
+    code_cells[DecodeCache::SIZE] = 0;
+    code_used = 0;
+    proc->decoded.clear();
+    proc->decoded.code_written = false;
+}
+
+#ifndef VM_JIT_X86_64
+
+bool Jit::prepare(Processor& proc)
+{
+    return false;
+}
+
+bool Jit::compile(uint16_t address)
+{
+    return false;
+}
+
+#else
+
+namespace
+{
+    // x86-64 registers
+    enum Reg { RAX = 0, RCX, RDX, RBX, RSP, RBP, RSI, RDI, R8, R9, R10, R11, R12, R13, R14, R15 };
+    // Condition codes
+    enum Cond { CC_B = 0x2, CC_E = 0x4, CC_NE = 0x5, CC_A = 0x7, CC_L = 0xC, CC_G = 0xF };
+
+    // Registers holding the context in the compiled code
+    constexpr int REGS = R12, CELLS = R13, FLAGS = R14, PROC = R15, CODE_CELLS = RBX;
+
+    constexpr int NO_INDEX = -1;
+
+    // Encoder of the few x86-64 instructions the compiler needs
+    class Emitter
+    {
+    public:
+        std::vector<uint8_t> bytes;
+
+        void byte(uint8_t b) { bytes.push_back(b); }
+        void imm16(uint16_t v) { byte(v); byte(v >> 8); }
+        void imm32(uint32_t v) { imm16(v); imm16(v >> 16); }
+        void imm64(uint64_t v) { imm32(v); imm32(v >> 32); }
+
+        // Instruction with a memory operand [base + index * scale + disp]
+        void op_mem(std::initializer_list<uint8_t> opcode, bool wide, int reg, int base,
+                    int index, int scale, int32_t disp, bool word_size = false)
+        {
+            if (word_size) byte(0x66);
+            rex(wide, reg, index < 0 ? 0 : index, base);
+            for (uint8_t b : opcode) byte(b);
+
+            bool need_sib = index >= 0 || (base & 7) == RSP;
+            int mod = disp == 0 && (base & 7) != RBP ? 0 : (disp >= -128 && disp <= 127 ? 1 : 2);
+            byte(mod << 6 | (reg & 7) << 3 | (need_sib ? 4 : base & 7));
+            if (need_sib)
+            {
+                int scale_bits = scale == 8 ? 3 : scale == 4 ? 2 : scale == 2 ? 1 : 0;
+                byte(scale_bits << 6 | (index < 0 ? 4 : index & 7) << 3 | (base & 7));
+            }
+            if (mod == 1) byte(disp);
+            else if (mod == 2) imm32(disp);
+        }
+
+        // Instruction with two register operands
+        void op_rr(std::initializer_list<uint8_t> opcode, bool wide, int reg, int rm)
+        {
+            rex(wide, reg, 0, rm);
+            for (uint8_t b : opcode) byte(b);
+            byte(0xC0 | (reg & 7) << 3 | (rm & 7));
+        }
+
+        void push(int r) { if (r >= 8) byte(0x41); byte(0x50 + (r & 7)); }
+        void pop(int r) { if (r >= 8) byte(0x41); byte(0x58 + (r & 7)); }
+        void mov_imm32(int r, uint32_t v) { if (r >= 8) byte(0x41); byte(0xB8 + (r & 7)); imm32(v); }
+        void mov_imm64(int r, uint64_t v) { byte(0x48 | (r >= 8)); byte(0xB8 + (r & 7)); imm64(v); }
+        void mov_rr(int dst, int src, bool wide = false) { op_rr({0x89}, wide, src, dst); }
+        void movsxd(int dst, int src) { op_rr({0x63}, true, dst, src); }
+        void setcc(int cc, int r) { op_rr({0x0F, uint8_t(0x90 + cc)}, false, 0, r); }
+        void movzx_byte(int dst, int src) { op_rr({0x0F, 0xB6}, false, dst, src); }
+        void shift_left(int r, uint8_t n) { op_rr({0xC1}, false, 4, r); byte(n); }
+        void shift_right(int r, uint8_t n) { op_rr({0xC1}, false, 5, r); byte(n); }
+        void call(const void* fn) { mov_imm64(RAX, uint64_t(fn)); byte(0xFF); byte(0xD0); }
+
+        // Short forward jump, patched by bind
+        size_t jump_if(int cc) { byte(0x70 + cc); byte(0); return bytes.size(); }
+        void bind(size_t from) { bytes[from - 1] = uint8_t(bytes.size() - from); }
+
+    private:
+        void rex(bool wide, int reg, int index, int base)
+        {
+            uint8_t prefix = 0x40 | wide << 3 | (reg >> 3) << 2 | (index >> 3) << 1 | (base >> 3);
+            if (prefix != 0x40) byte(prefix);
+        }
+    };
+}
+
+// Functions called from the compiled code
+
+// Executing an instruction without native code by its Command object.
+// Returns 1 if the instruction has overwritten compiled code
+static uint32_t jit_run_command(Processor* proc, uint32_t word_value)
+{
+    Word word = Word();
+    word.uval = word_value;
+    proc->exec_command(word);
+    proc->sync_flags();
+    return proc->decoded.code_written;
+}
+
+// Writing a word that hits compiled code through the memory, so the records are emptied
+static void jit_store(Processor* proc, uint32_t address, uint32_t value)
+{
+    Word word = Word();
+    word.uval = value;
+    proc->memory.set_word(address, word);
+}
+
+static void jit_push(Processor* proc, uint32_t address)
+{
+    proc->push(address);
+}
+
+static uint32_t jit_pop(Processor* proc)
+{
+    return proc->pop();
+}
+
+namespace
+{
+    // Leaving the block: the Instruction Pointer to continue from is in eax
+    void emit_return(Emitter& e)
+    {
+        e.pop(R15); e.pop(R14); e.pop(R13); e.pop(R12); e.pop(RBX);
+        e.byte(0xC3);
+    }
+
+    void emit_exit(Emitter& e, uint16_t next_ip)
+    {
+        e.mov_imm32(RAX, next_ip);
+        emit_return(e);
+    }
+
+    // dst = value pointed to by the address register
+    void emit_load_value(Emitter& e, int dst, uint8_t reg)
+    {
+        e.op_mem({0x0F, 0xB7}, false, RSI, REGS, NO_INDEX, 1, reg * 2); // movzx esi, word [regs + reg*2]
+        e.op_mem({0x8B}, false, dst, CELLS, RSI, 2, 0);                 // mov dst, [cells + rsi*2]
+    }
+
+    // Storing eax where the address register points. If the word overlaps
+    // compiled code, the block is left before the next instruction
+    void emit_store_value(Emitter& e, uint8_t reg, uint16_t next_ip)
+    {
+        e.op_mem({0x0F, 0xB7}, false, RSI, REGS, NO_INDEX, 1, reg * 2);
+        e.op_mem({0x89}, false, RAX, CELLS, RSI, 2, 0);                  // mov [cells + rsi*2], eax
+        e.op_mem({0x83}, false, 7, CODE_CELLS, RSI, 1, 0, true);         // cmp word [code_cells + rsi], 0
+        e.byte(0);
+        size_t skip = e.jump_if(CC_E);
+        e.mov_rr(RDI, PROC, true);
+        e.mov_rr(RDX, RAX);
+        e.call((const void*)&jit_store);
+        emit_exit(e, next_ip);
+        e.bind(skip);
+    }
+
+    // Collecting flags in edx: the bit is set if the condition of the last comparison holds
+    void emit_flag_bit(Emitter& e, int cc, uint8_t bit)
+    {
+        e.setcc(cc, RCX);
+        e.movzx_byte(RCX, RCX);
+        if (bit) e.shift_left(RCX, bit);
+        e.op_rr({0x09}, false, RCX, RDX); // or edx, ecx
+    }
+
+    // Zero, parity and sign flags of eax (Command::set_flags_int)
+    void emit_flags_int(Emitter& e)
+    {
+        e.op_rr({0x85}, false, RAX, RAX); // test eax, eax
+        emit_flag_bit(e, CC_E, 0);
+        e.mov_rr(RCX, RAX);               // Parity: abs(x) % 2 == 0 is the lowest bit being 0
+        e.op_rr({0xF7}, false, 2, RCX);   // not ecx
+        e.op_rr({0x83}, false, 4, RCX);   // and ecx, 1
+        e.byte(1);
+        e.shift_left(RCX, 1);
+        e.op_rr({0x09}, false, RCX, RDX);
+        e.mov_rr(RCX, RAX);               // Sign
+        e.shift_right(RCX, 31);
+        e.shift_left(RCX, 8);
+        e.op_rr({0x09}, false, RCX, RDX);
+    }
+
+    // Overflow flags of a 64-bit result in rax whose 32-bit part is eax
+    // (ArithCm::add_int_check_overflow and mul_int_check_overflow)
+    void emit_flags_overflow(Emitter& e)
+    {
+        e.movsxd(RCX, RAX);
+        e.op_rr({0x39}, true, RCX, RAX);  // cmp rax, rcx
+        emit_flag_bit(e, CC_NE, 9);
+        e.mov_rr(RCX, RAX);               // Zero-extended value
+        e.op_rr({0x39}, true, RCX, RAX);
+        emit_flag_bit(e, CC_NE, 10);
+    }
+
+    // Replacing the bits of the mask in the status flags with edx
+    void emit_commit_flags(Emitter& e, uint16_t mask)
+    {
+        e.op_mem({0x81}, false, 4, FLAGS, NO_INDEX, 1, 0, true); // and word [flags], ~mask
+        e.imm16(uint16_t(~mask));
+        e.op_mem({0x09}, false, RDX, FLAGS, NO_INDEX, 1, 0, true); // or word [flags], dx
+    }
+
+    void emit_clear_edx(Emitter& e)
+    {
+        e.op_rr({0x31}, false, RDX, RDX);
+    }
+
+    // ecx = target of a jump instruction at the address (TransCm::calc_instraction_pointer)
+    void emit_jump_target(Emitter& e, Word word, uint16_t address)
+    {
+        uint8_t code = word.cmd3ops.regs[0];
+        if (code == 0)
+            e.mov_imm32(RCX, word.cmd2ops.adrs);
+        else if (code == 1)
+            e.op_mem({0x0F, 0xB7}, false, RCX, CELLS, NO_INDEX, 1, word.cmd2ops.adrs * 2);
+        else if (code == 2)
+        {
+            e.op_mem({0x0F, 0xB7}, false, RCX, REGS, NO_INDEX, 1, word.cmd3ops.regs[2] * 2);
+            e.op_mem({0x0F, 0xB7}, false, RAX, REGS, NO_INDEX, 1, word.cmd3ops.regs[1] * 2);
+            e.op_rr({0x01}, false, RAX, RCX);        // add ecx, eax
+            e.op_rr({0x0F, 0xB7}, false, RCX, RCX);  // movzx ecx, cx
+        }
+        else
+            e.mov_imm32(RCX, uint16_t(address + word.cmd2ops.adrs));
+    }
+
+    // Jump, call or return from a subroutine that ends the block
+    void emit_transition(Emitter& e, Word word, uint16_t address)
+    {
+        uint8_t cmd = word.cmd3ops.cmd;
+        if (cmd == OP_CALL)
+        {
+            e.mov_rr(RDI, PROC, true);
+            e.mov_imm32(RSI, uint16_t(address + 2));
+            e.call((const void*)&jit_push);
+            emit_exit(e, word.cmd2ops.adrs);
+            return;
+        }
+        if (cmd == OP_ENDP)
+        {
+            e.mov_rr(RDI, PROC, true);
+            e.call((const void*)&jit_pop);
+            emit_return(e);
+            return;
+        }
+
+        emit_jump_target(e, word, address);
+        if (cmd == OP_JMP)
+        {
+            e.mov_rr(RAX, RCX);
+            emit_return(e);
+            return;
+        }
+
+        // Conditional jump: (flags & mask) is compared with value as in the TransCm commands
+        int condition = (cmd - OP_JE) / 3, group = (cmd - OP_JE) % 3;
+        uint16_t equal = 1 << (2 + 2 * group), greater = 1 << (3 + 2 * group);
+        uint16_t mask = 0, value = 0;
+        int cc = CC_E;
+        switch (condition)
+        {
+        case 0: mask = equal; value = equal; break;                          // e
+        case 1: mask = group == 2 ? equal | greater : greater;               // g
+                value = greater; break;
+        case 2: mask = equal | greater; break;                               // l
+        case 3: mask = equal; break;                                         // ne
+        case 4: mask = equal | greater; cc = CC_NE; break;                   // ge
+        default: mask = greater; break;                                      // le
+        }
+        e.op_mem({0x0F, 0xB7}, false, RAX, FLAGS, NO_INDEX, 1, 0); // movzx eax, word [flags]
+        e.op_rr({0x81}, false, 4, RAX);                            // and eax, mask
+        e.imm32(mask);
+        e.op_rr({0x81}, false, 7, RAX);                            // cmp eax, value
+        e.imm32(value);
+        e.mov_imm32(RAX, uint16_t(address + 2));
+        e.op_rr({0x0F, uint8_t(0x40 + cc)}, false, RAX, RCX);     // cmovcc eax, ecx
+        emit_return(e);
+    }
+
+    // Instruction inside the block. Returns false if it has no native code
+    bool emit_native(Emitter& e, Word word, uint16_t address)
+    {
+        uint8_t cmd = word.cmd3ops.cmd;
+        const uint8_t* regs = word.cmd3ops.regs;
+        uint16_t next_ip = address + 2;
+
+        switch (cmd)
+        {
+        case OP_LOAD:
+            e.op_mem({0xC7}, false, 0, REGS, NO_INDEX, 1, word.cmd2ops.reg * 2, true); // mov word [regs + reg*2], adrs
+            e.imm16(word.cmd2ops.adrs);
+            return true;
+        case OP_LOADR:
+            e.op_mem({0x0F, 0xB7}, false, RAX, REGS, NO_INDEX, 1, regs[1] * 2);
+            e.op_mem({0x89}, false, RAX, REGS, NO_INDEX, 1, regs[0] * 2, true);
+            return true;
+        case OP_LOADRV:
+            emit_load_value(e, RAX, regs[1]);
+            emit_store_value(e, regs[0], next_ip);
+            return true;
+
+        case OP_ADD:
+        case OP_SUB:
+        case OP_MUL:
+            emit_load_value(e, RAX, regs[1]);
+            emit_load_value(e, RCX, regs[2]);
+            e.movsxd(RAX, RAX);
+            e.movsxd(RCX, RCX);
+            if (cmd == OP_MUL) e.op_rr({0x0F, 0xAF}, true, RAX, RCX); // imul rax, rcx
+            else if (cmd == OP_SUB) e.op_rr({0x29}, true, RCX, RAX);   // sub rax, rcx
+            else e.op_rr({0x01}, true, RCX, RAX);                      // add rax, rcx
+            emit_clear_edx(e);
+            emit_flags_overflow(e);
+            emit_flags_int(e);
+            emit_commit_flags(e, 1 << 0 | 1 << 1 | 1 << 8 | 1 << 9 | 1 << 10);
+            emit_store_value(e, regs[0], next_ip);
+            return true;
+
+        case OP_INC:
+        case OP_DEC:
+            emit_load_value(e, RAX, regs[2]);
+            e.mov_rr(R8, RAX);
+            e.op_rr({0x83}, false, cmd == OP_INC ? 0 : 5, RAX); // add/sub eax, 1
+            e.byte(1);
+            emit_clear_edx(e);
+            e.op_rr({0x39}, false, R8, RAX);                     // cmp eax, r8d
+            emit_flag_bit(e, cmd == OP_INC ? CC_L : CC_G, 9);
+            e.op_rr({0x39}, false, R8, RAX);
+            emit_flag_bit(e, cmd == OP_INC ? CC_B : CC_A, 10);
+            emit_commit_flags(e, 1 << 9 | 1 << 10);
+            emit_store_value(e, regs[2], next_ip);
+            return true;
+
+        case OP_CMP:
+        case OP_CMPU:
+        {
+            uint8_t bit = cmd == OP_CMP ? 2 : 4;
+            emit_load_value(e, RAX, regs[0]);
+            emit_load_value(e, R8, regs[1]);
+            emit_clear_edx(e);
+            e.op_rr({0x39}, false, R8, RAX);
+            emit_flag_bit(e, CC_E, bit);
+            e.op_rr({0x39}, false, R8, RAX);
+            emit_flag_bit(e, cmd == OP_CMP ? CC_G : CC_A, bit + 1);
+            emit_commit_flags(e, 3 << bit);
+            return true;
+        }
+
+        case OP_AND:
+        case OP_OR:
+        case OP_XOR:
+        case OP_NOT:
+            if (cmd == OP_NOT)
+            {
+                emit_load_value(e, RAX, regs[2]);
+                e.op_rr({0xF7}, false, 2, RAX); // not eax
+            }
+            else
+            {
+                emit_load_value(e, RAX, regs[1]);
+                emit_load_value(e, R8, regs[2]);
+                e.op_rr({uint8_t(cmd == OP_AND ? 0x21 : cmd == OP_OR ? 0x09 : 0x31)}, false, R8, RAX);
+            }
+            emit_clear_edx(e);
+            emit_flags_int(e);
+            emit_commit_flags(e, 1 << 0 | 1 << 1 | 1 << 8);
+            emit_store_value(e, regs[0], next_ip);
+            return true;
+        }
+        return false;
+    }
+
+    // Instruction executed by its Command object
+    void emit_command_call(Emitter& e, Word word, uint16_t address)
+    {
+        e.mov_rr(RDI, PROC, true);
+        e.mov_imm32(RSI, word.uval);
+        e.call((const void*)&jit_run_command);
+        e.op_rr({0x85}, false, RAX, RAX); // test eax, eax
+        size_t skip = e.jump_if(CC_E);
+        emit_exit(e, address + 2);
+        e.bind(skip);
+    }
+}
+
+// Allocating the tables and executable memory for the processor
+bool Jit::prepare(Processor& proc)
+{
+    if (code == nullptr)
+    {
+        void* memory = mmap(nullptr, CODE_SIZE, PROT_READ | PROT_EXEC, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (memory == MAP_FAILED) return false;
+        code = static_cast<uint8_t*>(memory);
+
+        blocks = new Block[DecodeCache::SIZE]();
+        counters = new uint16_t[DecodeCache::SIZE]();
+        code_cells = new uint8_t[DecodeCache::SIZE + 1](); // One more for a word at the last address
+    }
+    if (this->proc != &proc)
+    {
+        this->proc = &proc;
+        flush();
+    }
+
+    context.regs = proc.address_regs;
+    context.cells = proc.memory.cells();
+    context.flags = &proc.flags;
+    context.proc = &proc;
+    context.code_cells = code_cells;
+    return true;
+}
+
+// Compiling the block starting at the address
+bool Jit::compile(uint16_t address)
+{
+    // The longest instruction takes less than 256 bytes
+    if (CODE_SIZE - code_used < MAX_BLOCK_COMMANDS * 256) flush();
+
+    // Saving the callee-saved registers and loading the context into them
+    Emitter e;
+    e.push(RBX); e.push(R12); e.push(R13); e.push(R14); e.push(R15);
+    e.op_mem({0x8B}, true, REGS, RDI, NO_INDEX, 1, offsetof(Context, regs));
+    e.op_mem({0x8B}, true, CELLS, RDI, NO_INDEX, 1, offsetof(Context, cells));
+    e.op_mem({0x8B}, true, FLAGS, RDI, NO_INDEX, 1, offsetof(Context, flags));
+    e.op_mem({0x8B}, true, PROC, RDI, NO_INDEX, 1, offsetof(Context, proc));
+    e.op_mem({0x8B}, true, CODE_CELLS, RDI, NO_INDEX, 1, offsetof(Context, code_cells));
+
+    uint16_t ip = address;
+    int amount = 0;
+    bool transition = false;
+    while (amount < MAX_BLOCK_COMMANDS && ip + 1u < Memory::MEM_SIZE)
+    {
+        Word word = proc->memory.get_word(ip);
+        uint8_t cmd = word.cmd3ops.cmd;
+        if (cmd == OP_END || cmd >= OP_AMOUNT || (cmd >= OP_READ && cmd <= OP_READF)) break;
+
+        // Writes into these cells must discard the block
+        code_cells[ip] = code_cells[ip + 1] = 1;
+        used_pages |= page_bit(ip) | page_bit(uint16_t(ip + 1));
+        proc->decoded.decode(ip, word, Word(), nullptr);
+        amount++;
+
+        if (cmd <= OP_JLEF || cmd == OP_CALL || cmd == OP_ENDP)
+        {
+            emit_transition(e, word, ip);
+            transition = true;
+            break;
+        }
+        if (!emit_native(e, word, ip))
+            emit_command_call(e, word, ip);
+        ip += 2;
+    }
+
+    if (amount == 0)
+    {
+        counters[address] = NEVER;
+        return false;
+    }
+    if (!transition) emit_exit(e, ip);
+
+    uint8_t* start = code + code_used;
+    mprotect(code, CODE_SIZE, PROT_READ | PROT_WRITE);
+    std::memcpy(start, e.bytes.data(), e.bytes.size());
+    mprotect(code, CODE_SIZE, PROT_READ | PROT_EXEC);
+    code_used += (e.bytes.size() + 15) & ~size_t(15);
+
+    blocks[address] = reinterpret_cast<Block>(start);
+    return true;
+}
+
+#endif // VM_JIT_X86_64
@@ -1,104 +1,374 @@
 #include "loader.h"
+#include "image.h"
+#include "mapped.h"
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <system_error>
+#include <thread>
 
-// Splitting a string into pieces separated by a space
-std::vector<std::string> split(const std::string& line) noexcept
+// The text loader scans the file in place: the parts of a line are kept as pointers
+// into the file contents, and the numbers are parsed by std::from_chars
+namespace
 {
-    std::stringstream ss(line);
-    std::string line_part;
-    std::vector<std::string> splitted = std::vector<std::string>();
-    while (std::getline(ss, line_part, ' '))
-    {
-        if (line_part == "#")
-            return splitted;
-        if (line_part != "")
-            splitted.push_back(line_part);
+    constexpr int MAX_PARTS = 5; // A command line has at most five parts that are used
+    constexpr size_t MIN_CHUNK_BYTES = 1 << 18; // Smaller files are not worth a thread
+
+    // Parts of a line separated by spaces, up to the "#" part
+    struct LineParts
+    {
+        const char* begin[MAX_PARTS];
+        const char* end[MAX_PARTS];
+        int count = 0; // Number of parts on the line (it can be larger than MAX_PARTS)
+
+        bool is(int i, char c) const noexcept { return end[i] - begin[i] == 1 && *begin[i] == c; }
+    };
+
+    void split_line(const char* pos, const char* line_end, LineParts& parts) noexcept
+    {
+        parts.count = 0;
+        while (pos < line_end)
+        {
+            while (pos < line_end && *pos == ' ') pos++;
+            if (pos == line_end) break;
+            const char* start = pos;
+            while (pos < line_end && *pos != ' ') pos++;
+            if (pos - start == 1 && *start == '#') break;
+            if (parts.count < MAX_PARTS)
+            {
+                parts.begin[parts.count] = start;
+                parts.end[parts.count] = pos;
+            }
+            parts.count++;
+        }
     }
-    return splitted;
-}
 
-// Parsing a string with memory allocation for a variable
-void parse_variable(std::vector<std::string>& parts, uint16_t adrs, Processor& cpu) noexcept
-{
-    Word word = Word();
-    if (parts[0] == "i") word.ival = stoi(parts[1]);
-    else if (parts[0] == "u") word.uval = stoi(parts[1]);
-    else if (parts[0] == "f") word.fval = stof(parts[1]);
-    cpu.memory.set_word(adrs, word);
-}
+    // Parsing a whole part as an integer within the limits
+    bool parse_int(const LineParts& parts, int i, int64_t low, int64_t high, int64_t& value) noexcept
+    {
+        const char* first = parts.begin[i];
+        if (first < parts.end[i] && *first == '+') first++;
+        std::from_chars_result result = std::from_chars(first, parts.end[i], value);
+        return result.ec == std::errc() && result.ptr == parts.end[i] && value >= low && value <= high;
+    }
 
-// Parsing strings of code
-Word parse_command(std::vector<std::string>& parts, Processor& cpu) noexcept
-{
-    Word command = Word();
-    command.cmd3ops.cmd = std::stoi(parts[1]);
-    if (parts.size() == 3) // 3 parts per line
+    // Integer part of a command, which is cut to the size of its field as before
+    bool parse_field(const LineParts& parts, int i, int64_t& value) noexcept
     {
-        if (command.cmd3ops.cmd == 51) command.cmd2ops.adrs = std::stoi(parts[2]);
-        else command.cmd3ops.regs[2] = std::stoi(parts[2]);
+        return parse_int(parts, i, INT32_MIN, INT32_MAX, value);
     }
-    else if (parts.size() == 4) // 4 pieces per line
+
+    // Word of a variable line ("i", "u" or "f" and the value)
+    bool parse_variable(const LineParts& parts, Word& word) noexcept
     {
-        command.cmd2ops.reg = std::stoi(parts[2]);
-        command.cmd2ops.adrs = std::stoi(parts[3]);
+        if (parts.count < 2) return false;
+        if (parts.is(0, 'f'))
+        {
+            const char* first = parts.begin[1];
+            if (first < parts.end[1] && *first == '+') first++;
+            std::from_chars_result result = std::from_chars(first, parts.end[1], word.fval);
+            return result.ec == std::errc() && result.ptr == parts.end[1];
+        }
+        int64_t value;
+        if (!parse_int(parts, 1, INT32_MIN, parts.is(0, 'u') ? UINT32_MAX : INT32_MAX, value)) return false;
+        word.uval = uint32_t(value);
+        return true;
     }
-    else if (parts.size() > 4) // 5 pieces per line
-        for (int i = 0; i < 3; i++)
-            command.cmd3ops.regs[i] = std::stoi(parts[i + 2]);
-    return command;
-}
 
-// Parsing all strings
-bool parse_line_parts(std::vector<std::string>& parts, uint16_t address, Processor& cpu) noexcept
-{
-    Word command = Word();
+    // Word of a command line ("k", the code and the operands)
+    bool parse_command(const LineParts& parts, Word& command) noexcept
+    {
+        int64_t code, field[3];
+        if (parts.count < 2 || !parse_field(parts, 1, code)) return false;
+        command.cmd3ops.cmd = uint8_t(code);
+        if (parts.count == 3) // 3 parts per line
+        {
+            if (!parse_field(parts, 2, field[0])) return false;
+            if (command.cmd3ops.cmd == OP_CALL) command.cmd2ops.adrs = uint16_t(field[0]);
+            else command.cmd3ops.regs[2] = uint8_t(field[0]);
+        }
+        else if (parts.count == 4) // 4 pieces per line
+        {
+            if (!parse_field(parts, 2, field[0]) || !parse_field(parts, 3, field[1])) return false;
+            command.cmd2ops.reg = uint8_t(field[0]);
+            command.cmd2ops.adrs = uint16_t(field[1]);
+        }
+        else if (parts.count > 4) // 5 pieces per line
+        {
+            for (int i = 0; i < 3; i++)
+            {
+                if (!parse_field(parts, i + 2, field[i])) return false;
+                command.cmd3ops.regs[i] = uint8_t(field[i]);
+            }
+        }
+        return true;
+    }
 
-    if (parts[0] == "i" || parts[0] == "u" || parts[0] == "f")
-        parse_variable(parts, address, cpu);
-    else if (parts[0] == "e")
+    bool is_word_line(const LineParts& parts) noexcept
     {
-        command.uval = 0;
-        cpu.memory.set_word(address, command);
+        return parts.is(0, 'e') || parts.is(0, 'i') || parts.is(0, 'u') || parts.is(0, 'f') || parts.is(0, 'k');
     }
-    else if (parts[0] == "k")
+
+    // Consecutive words parsed from a chunk
+    struct Run
+    {
+        uint16_t address;
+        uint32_t first; // Index of the first word in Chunk::words
+        uint32_t count;
+    };
+
+    // Part of the text file made of whole lines
+    struct Chunk
+    {
+        const char* begin;
+        const char* end;
+
+        // Counted by the first pass
+        unsigned lines = 0;
+        bool addressed = false;   // Does the chunk have an "a" line
+        uint16_t last_address = 0; // Address of the last "a" line
+        uint16_t advance = 0;     // Cells taken by the words after the last "a" line (or from the beginning)
+
+        // Known before the second pass
+        unsigned first_line = 1;
+        uint16_t start_address = 0;
+
+        // Parsed by the second pass
+        std::vector<Word> words;
+        std::vector<Run> runs;
+        std::string errors;       // Reports of the malformed lines
+        bool has_entry = false;
+        uint16_t entry = 0;
+    };
+
+    const char* line_end_of(const char* pos, const char* end) noexcept
     {
-        command = parse_command(parts, cpu);
-        cpu.memory.set_word(address, command);
+        const void* found = std::memchr(pos, '\n', size_t(end - pos));
+        return found ? static_cast<const char*>(found) : end;
     }
-    else return false; // The command is not written to memory
 
-    return true; // The command is written to memory
-}
+    // First pass: the lines and the "a" lines, which give the addresses of the next chunks.
+    // Only the first part of the other lines is looked at
+    void count_chunk(Chunk& chunk) noexcept
+    {
+        LineParts parts;
+        for (const char* pos = chunk.begin; pos < chunk.end; chunk.lines++)
+        {
+            const char* line_end = line_end_of(pos, chunk.end);
+            const char* next = line_end < chunk.end ? line_end + 1 : chunk.end;
+            if (line_end > pos && line_end[-1] == '\r') line_end--;
+            const char* first = pos;
+            while (first < line_end && *first == ' ') first++;
+            bool single = first + 1 == line_end || (first + 1 < line_end && first[1] == ' ');
+            if (!single) {}
+            else if (*first == 'a')
+            {
+                // A wrong "a" line changes nothing, it is reported by the second pass
+                int64_t address;
+                split_line(first, line_end, parts);
+                if (parts.count > 1 && parse_field(parts, 1, address))
+                {
+                    chunk.addressed = true;
+                    chunk.last_address = uint16_t(address);
+                    chunk.advance = 0;
+                }
+            }
+            else if (*first == 'e' || *first == 'i' || *first == 'u' || *first == 'f' || *first == 'k')
+                chunk.advance += 2;
+            pos = next;
+        }
+    }
 
-// Function that implements the bootloader
-void load(Processor& cpu, char* filename) noexcept
-{
-    std::string line;
-    std::vector<std::string> line_parts;
-    std::ifstream fin;
-    fin.open(filename);
-    uint16_t code_address = 0, run_address = 0;
-    if (fin)
-    {
-        // Loading commands and variables into memory
-        while (std::getline(fin, line))
+    // Second pass: parsing the words of the chunk. Every word line takes the next address,
+    // even if it is malformed, so the addresses do not depend on the other chunks
+    void parse_chunk(Chunk& chunk, const char* filename)
+    {
+        uint16_t code_address = chunk.start_address;
+        LineParts parts;
+        unsigned line_number = chunk.first_line;
+        for (const char* pos = chunk.begin; pos < chunk.end; line_number++)
         {
-            line_parts = split(line);
+            const char* line_end = line_end_of(pos, chunk.end);
+            const char* next = line_end < chunk.end ? line_end + 1 : chunk.end;
+            if (line_end > pos && line_end[-1] == '\r') line_end--; // Lines ending with "\r\n"
 
-            if (line_parts.size() > 0)
+            split_line(pos, line_end, parts);
+            bool valid = true;
+            if (parts.count == 0) {}
+            else if (parts.is(0, 'a'))
+            {
+                int64_t address;
+                valid = parts.count > 1 && parse_field(parts, 1, address);
+                if (valid) code_address = uint16_t(address);
+            }
+            else if (is_word_line(parts))
             {
-                if (line_parts[0] == "a")
-                    code_address = std::stoi(line_parts[1]);
-                else
+                Word word = Word();
+                int64_t start;
+                if (parts.is(0, 'e'))
                 {
-                    if (line_parts[0] == "e")
-                        run_address = std::stoi(line_parts[1]) - 2;
-                    if (parse_line_parts(line_parts, code_address, cpu))
-                        code_address += 2;
+                    valid = parts.count > 1 && parse_field(parts, 1, start);
+                    if (valid)
+                    {
+                        chunk.has_entry = true;
+                        chunk.entry = uint16_t(start - 2);
+                    }
                 }
+                else if (parts.is(0, 'k')) valid = parse_command(parts, word);
+                else valid = parse_variable(parts, word);
+
+                // The word must be inside the memory
+                valid = valid && code_address < Memory::MEM_SIZE;
+                if (valid)
+                {
+                    Run* run = chunk.runs.empty() ? nullptr : &chunk.runs.back();
+                    if (run && uint16_t(run->address + 2 * run->count) == code_address) run->count++;
+                    else chunk.runs.push_back({ code_address, uint32_t(chunk.words.size()), 1 });
+                    chunk.words.push_back(word);
+                }
+                code_address += 2;
             }
+
+            if (!valid)
+                chunk.errors += "Malformed line " + std::to_string(line_number) + " in file \"" + filename + "\": "
+                    + std::string(pos, line_end) + '\n';
+            pos = next;
         }
+    }
+
+    // Running the task for every chunk, the first one on the calling thread
+    template <typename Task>
+    void for_each_chunk(std::vector<Chunk>& chunks, Task task)
+    {
+        std::vector<std::thread> workers;
+        for (size_t i = 1; i < chunks.size(); i++)
+        {
+            try { workers.emplace_back(task, std::ref(chunks[i])); }
+            catch (const std::system_error&) { task(chunks[i]); } // No more threads
+        }
+        task(chunks[0]);
+        for (std::thread& worker : workers)
+            worker.join();
+    }
 
+    // Loading the lines of the text format. Large files are split into chunks at the line
+    // boundaries, which are parsed on their own threads. Returns false if a line is malformed
+    bool load_text(Processor& cpu, const char* filename, const char* data, size_t size, uint16_t& run_address, unsigned threads)
+    {
+        size_t count = std::max<size_t>(1, std::min<size_t>(threads, size / MIN_CHUNK_BYTES));
+        std::vector<Chunk> chunks(count);
+        const char* pos = data;
+        for (size_t i = 0; i < count; i++)
+        {
+            const char* end = data + size * (i + 1) / count;
+            if (end > pos && end < data + size) end = line_end_of(end - 1, data + size) + 1;
+            if (end > data + size) end = data + size;
+            chunks[i].begin = pos;
+            chunks[i].end = std::max(pos, end);
+            pos = chunks[i].end;
+        }
+
+        // The first chunk starts at the address 0, the others after the words of the previous ones
+        if (count > 1)
+        {
+            for_each_chunk(chunks, [](Chunk& chunk) { count_chunk(chunk); });
+            for (size_t i = 1; i < count; i++)
+            {
+                const Chunk& prev = chunks[i - 1];
+                chunks[i].first_line = prev.first_line + prev.lines;
+                chunks[i].start_address = uint16_t((prev.addressed ? prev.last_address : prev.start_address) + prev.advance);
+            }
+        }
+        for_each_chunk(chunks, [filename](Chunk& chunk) { parse_chunk(chunk, filename); });
+
+        // The words are copied in the order of the file, so a later line wins
+        bool ok = true;
+        for (const Chunk& chunk : chunks)
+        {
+            for (const Run& run : chunk.runs)
+                cpu.memory.load_words(run.address, chunk.words.data() + run.first, run.count);
+            if (chunk.has_entry) run_address = chunk.entry;
+            *cpu.output << chunk.errors;
+            ok = ok && chunk.errors.empty();
+        }
+        return ok;
+    }
+}
+
+// Loading commands and variables from a file into memory without running them.
+// The file is either a binary image (see image.h) or the text format
+LoadStatus load_program(Processor& cpu, const char* filename, uint16_t& run_address, unsigned threads) noexcept
+{
+    run_address = 0;
+    MappedFile file;
+    if (!file.open(filename)) return LoadStatus::NotOpened;
+
+    ImageStatus image = load_image(cpu, file.data(), file.size(), run_address);
+    if (image == ImageStatus::Loaded) return LoadStatus::Loaded;
+    if (image == ImageStatus::Invalid)
+    {
+        *cpu.output << "Damaged program image \"" << filename << "\".\n";
+        return LoadStatus::Malformed;
+    }
+
+    bool ok = load_text(cpu, filename, file.data(), file.size(), run_address, threads);
+    return ok ? LoadStatus::Loaded : LoadStatus::Malformed;
+}
+
+// Function that implements the bootloader
+void load(Processor& cpu, char* filename, unsigned threads) noexcept
+{
+    uint16_t run_address = 0;
+    LoadStatus status = load_program(cpu, filename, run_address, threads);
+    if (status == LoadStatus::Loaded)
         cpu.run(run_address);
+    else if (status == LoadStatus::NotOpened)
+        *cpu.output << "Failed to open file.\n";
+}
+
+// Measuring the loading speed: a text file with the given number of lines is generated,
+// loaded several times on one thread and on the given number of threads, and deleted.
+// The addresses start again every 16000 words
+void bench_loader(unsigned lines, unsigned threads)
+{
+    std::filesystem::path path = std::filesystem::temp_directory_path() / "vm9_bench_load.txt";
+    {
+        static const char* const samples[] = { "k 23 1 2 ", "k 29 3 3 4 ", "u 123456 ", "k 33 5 5 6 ",
+            "i -77 ", "f 1.5 ", "k 51 180 ", "k 26 1 2 ", "k 6 0 38 ", "k 54 " };
+        std::ofstream fout(path, std::ios::out | std::ios::trunc);
+        for (unsigned i = 0; i < lines; i++)
+        {
+            if (i % 16000 == 0) fout << "a 0\n";
+            fout << samples[i % 10] << '\n';
+        }
+    }
+    std::uintmax_t bytes = std::filesystem::file_size(path);
+    std::cout << "Lines: " << lines << ", bytes: " << bytes << '\n';
+
+    using Clock = std::chrono::steady_clock;
+    Processor proc = Processor();
+    const int runs = 5;
+    for (unsigned used : { 1u, threads })
+    {
+        uint16_t run_address = 0;
+        LoadStatus status = LoadStatus::Loaded;
+        Clock::time_point start = Clock::now();
+        for (int i = 0; i < runs && status == LoadStatus::Loaded; i++)
+        {
+            proc.reset();
+            status = load_program(proc, path.string().c_str(), run_address, used);
+        }
+        double seconds = std::chrono::duration<double>(Clock::now() - start).count() / runs;
+        if (status != LoadStatus::Loaded)
+        {
+            std::cout << "Failed to load the generated file.\n";
+            break;
+        }
+        std::cout << "Threads: " << used << ", loading time: " << seconds * 1000 << " ms, "
+            << bytes / seconds / 1e6 << " MB/s\n";
+        if (threads <= 1) break;
     }
-    else std::cout << "Failed to open file.\n";
+    std::filesystem::remove(path);
 }
@@ -0,0 +1,77 @@
+#include "mapped.h"
+#include <cstring>
+#include <fstream>
+
+#if defined(__unix__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define VM_MMAP
+#endif
+
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+// Taking the file. A regular file is mapped, the rest is read
+bool MappedFile::open(const char* path)
+{
+    close();
+#ifdef VM_MMAP
+    int file = ::open(path, O_RDONLY);
+    if (file < 0) return false;
+    struct stat info;
+    if (fstat(file, &info) == 0 && S_ISREG(info.st_mode))
+    {
+        // An empty file cannot be mapped, but there is nothing to read either
+        void* memory = info.st_size > 0 ? mmap(nullptr, size_t(info.st_size), PROT_READ, MAP_PRIVATE, file, 0) : nullptr;
+        if (memory != MAP_FAILED)
+        {
+            ::close(file);
+            bytes = static_cast<const char*>(memory);
+            length = size_t(info.st_size);
+            mapped = memory != nullptr;
+            return true;
+        }
+    }
+    ::close(file);
+#endif
+    std::ifstream fin(path, std::ios::binary);
+    if (!fin) return false;
+    read(fin);
+    return true;
+}
+
+// Reading the stream to its end into a buffer that doubles when it is full
+void MappedFile::read(std::istream& stream)
+{
+    close();
+    size_t capacity = 1 << 16;
+    char* buffer = new char[capacity];
+    while (stream.read(buffer + length, std::streamsize(capacity - length)) || stream.gcount() > 0)
+    {
+        length += size_t(stream.gcount());
+        if (length < capacity) continue;
+        char* bigger = new char[capacity * 2];
+        std::memcpy(bigger, buffer, length);
+        delete[] buffer;
+        buffer = bigger;
+        capacity *= 2;
+    }
+    bytes = buffer;
+}
+
+void MappedFile::close() noexcept
+{
+#ifdef VM_MMAP
+    if (mapped) munmap(const_cast<char*>(bytes), length);
+    else delete[] bytes;
+#else
+    delete[] bytes;
+#endif
+    bytes = nullptr;
+    length = 0;
+    mapped = false;
+}
@@ -1,8 +1,9 @@
 #include "memory.h"
+#include <cstring>
 
 Memory::Memory()
 {
-    memory = new uint16_t[MEM_SIZE]();
+    memory = new Word[WORDS]();
 }
 
 Memory::~Memory()
@@ -10,29 +11,70 @@ Memory::~Memory()
     delete[] memory;
 }
 
+// Zeroing the pages written since the last clearing
 void Memory::clear()
 {
-    memory = new uint16_t[MEM_SIZE]();
+    constexpr uint32_t PAGE_WORDS = (1 << PAGE_BITS) / 2;
+    for (uint32_t page = 0; page < PAGES; page++)
+    {
+        if (!(dirty_pages & (uint64_t(1) << page))) continue;
+        // The last page also owns the extra word after the memory
+        uint32_t end = page == PAGES - 1 ? WORDS : (page + 1) * PAGE_WORDS;
+        for (uint32_t i = page * PAGE_WORDS; i < end; i++)
+            memory[i] = Word();
+    }
+    dirty_pages = 0;
 }
 
-void Memory::set_word(uint16_t address, Word word)
+// The first cell is the upper half of one word, the second is the lower half of the next
+Word Memory::get_split_word(uint16_t address) const noexcept
 {
-    memory[address] = word.cells[0];
-    memory[address + 1] = word.cells[1];
+    Word word = Word();
+    word.cells[0] = memory[address >> 1].cells[1];
+    word.cells[1] = memory[(address >> 1) + 1].cells[0];
+    return word;
 }
 
-void Memory::set_word(uint16_t address, uint16_t word_part1, uint16_t word_part2)
+void Memory::set_split_word(uint16_t address, Word word) noexcept
 {
-    memory[address] = word_part1;
-    memory[address + 1] = word_part2;
+    memory[address >> 1].cells[1] = word.cells[0];
+    memory[(address >> 1) + 1].cells[0] = word.cells[1];
+    dirty_pages |= page_bit(uint16_t(address + 1)); // The word can cross the page boundary
 }
 
-Word Memory::get_word(uint16_t address) const noexcept
+// Words at an even address are copied as a whole, at an odd one they are split
+void Memory::load_words(uint16_t address, const Word* words, uint32_t count)
 {
-    Word word = Word();
-    word.cells[1] = memory[address + 1];
-    word.cells[0] = memory[address];
-    return word;
+    if (count == 0) return;
+    if (address & 1)
+    {
+        for (uint32_t i = 0; i < count; i++)
+            set_split_word(uint16_t(address + 2 * i), words[i]);
+    }
+    else std::memcpy(memory + (address >> 1), words, count * sizeof(Word));
+
+    uint32_t last = address + 2 * count - 1;
+    for (uint32_t page = address >> PAGE_BITS; page <= (last >> PAGE_BITS); page++)
+        dirty_pages |= uint64_t(1) << (page % PAGES);
+    if (watcher)
+        for (uint32_t i = 0; i < count; i++)
+            watcher->invalidate(uint16_t(address + 2 * i));
+}
+
+uint16_t Memory::get_cell(uint16_t address) const noexcept
+{
+    return memory[address >> 1].cells[address & 1];
+}
+
+uint16_t* Memory::cells() noexcept
+{
+    dirty_pages = ~uint64_t(0);
+    return memory[0].cells;
+}
+
+void Memory::watch(DecodeCache* cache) noexcept
+{
+    watcher = cache;
 }
 
 void Memory::print_memory(uint16_t first, uint16_t last) const noexcept
@@ -40,7 +82,8 @@ void Memory::print_memory(uint16_t first, uint16_t last) const noexcept
     std::cout << "MEMORY:\n";
     while (first <= last)
     {
-        std::cout << "Cell " << first << " = " << (memory[first] >> 8) << " - " <<  (int)(uint8_t)memory[first] << '\n';
+        uint16_t cell = get_cell(first);
+        std::cout << "Cell " << first << " = " << (cell >> 8) << " - " <<  (int)(uint8_t)cell << '\n';
         first++;
     }
 }
@@ -0,0 +1,117 @@
+#include "output.h"
+
+OutputChannel::OutputChannel()
+{
+    buffer = new char[limit + MAX_NUMBER];
+}
+
+OutputChannel::~OutputChannel()
+{
+    finish();
+    stop_writer();
+    delete[] buffer;
+}
+
+// Choosing the flush policy. The buffers are resized for the number of bytes
+void OutputChannel::set_policy(Flush mode, size_t bytes)
+{
+    finish();
+    bool threaded = writer.joinable();
+    stop_writer();
+
+    policy = mode;
+    size_t new_limit = mode == Flush::Bytes && bytes > 0 ? bytes : DEFAULT_CAPACITY;
+    if (new_limit != limit)
+    {
+        delete[] buffer;
+        limit = new_limit;
+        buffer = new char[limit + MAX_NUMBER];
+    }
+    if (threaded) set_writer_thread(true);
+}
+
+// Writing the buffer on a separate thread
+void OutputChannel::set_writer_thread(bool enabled)
+{
+    if (enabled == writer.joinable()) return;
+    finish();
+    if (!enabled)
+    {
+        stop_writer();
+        return;
+    }
+    spare = new char[limit + MAX_NUMBER];
+    stopping = false;
+    writer = std::thread(&OutputChannel::write_loop, this);
+}
+
+// Writing the collected output. With the writer thread the buffer is given
+// to it, and the processor continues in the buffer the writer has finished
+void OutputChannel::flush() noexcept
+{
+    if (used == 0) return;
+    if (!writer.joinable())
+    {
+        sink->write(buffer, std::streamsize(used));
+        sink->flush();
+        used = 0;
+        return;
+    }
+
+    std::unique_lock<std::mutex> guard(lock);
+    changed.wait(guard, [this] { return pending == nullptr; });
+    pending = buffer;
+    pending_size = used;
+    buffer = spare;
+    spare = pending;
+    used = 0;
+    changed.notify_all();
+}
+
+// Writing the collected output and waiting until the stream has it
+void OutputChannel::finish() noexcept
+{
+    flush();
+    if (writer.joinable()) wait_writer();
+}
+
+// Waiting until the writer has written the buffer given to it
+void OutputChannel::wait_writer() noexcept
+{
+    std::unique_lock<std::mutex> guard(lock);
+    changed.wait(guard, [this] { return pending == nullptr; });
+}
+
+// Work of the writer thread
+void OutputChannel::write_loop()
+{
+    std::unique_lock<std::mutex> guard(lock);
+    while (true)
+    {
+        changed.wait(guard, [this] { return pending != nullptr || stopping; });
+        if (pending == nullptr) return; // Stopping with nothing to write
+
+        const char* data = pending;
+        size_t size = pending_size;
+        guard.unlock();
+        sink->write(data, std::streamsize(size));
+        sink->flush();
+        guard.lock();
+        pending = nullptr;
+        changed.notify_all();
+    }
+}
+
+// Stopping the writer thread after it has written everything given to it
+void OutputChannel::stop_writer()
+{
+    if (!writer.joinable()) return;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        stopping = true;
+    }
+    changed.notify_all();
+    writer.join();
+    delete[] spare;
+    spare = nullptr;
+}
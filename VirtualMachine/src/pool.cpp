@@ -0,0 +1,41 @@
+#include "pool.h"
+
+ProcessorPool::ProcessorPool(std::function<void(Processor&)> configure) : configure(std::move(configure))
+{
+}
+
+// Taking a reset processor from the pool or creating a new one
+std::unique_ptr<Processor> ProcessorPool::acquire()
+{
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        if (!processors.empty())
+        {
+            std::unique_ptr<Processor> proc = std::move(processors.back());
+            processors.pop_back();
+            return proc;
+        }
+    }
+    std::unique_ptr<Processor> proc(new Processor());
+    if (configure) configure(*proc);
+    return proc;
+}
+
+// Resetting the processor and returning it to the pool.
+// The reset happens outside the lock, so the workers do not wait for each other
+void ProcessorPool::release(std::unique_ptr<Processor> proc)
+{
+    if (!proc) return;
+    proc->reset();
+    proc->input = &std::cin;
+    proc->output = &std::cout;
+
+    std::lock_guard<std::mutex> guard(lock);
+    processors.push_back(std::move(proc));
+}
+
+size_t ProcessorPool::idle() const
+{
+    std::lock_guard<std::mutex> guard(lock);
+    return processors.size();
+}
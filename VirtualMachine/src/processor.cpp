@@ -1,5 +1,15 @@
 #include "processor.h"
 
+const Command* const Processor::commands[AMOUNT_COMMANDS] = { nullptr, new JumpCm(), new JEqCm(), new JEqUCm(), new JEqFCm(),
+    new JGrCm(), new JGrUCm(), new JGrFCm(), new JLsCm(), new JLsUCm(), new JLsFCm(),
+    new JNEqCm(), new JNEqUCm(), new JNEqFCm(), new JGEqCm(), new JGEqUCm(), new JGEqFCm(),
+    new JLEqCm(), new JLEqUCm(), new JLEqFCm(), new PrintCm(), new PrintUCm(), new PrintFCm(),
+    new LoadCm(), new NegCm(), new NegFCm(), new CmpCm(), new CmpUCm(), new CmpFCm(), new AddCm(),
+    new AddFCm(), new SubCm(), new SubFCm(), new MulCm(), new MulFCm(), new DivUCm(), new DivCm(),
+    new DivFCm(), new ModUCm(), new ModCm(), new IncCm(), new DecCm(), new ReadCm(), new ReadUCm(),
+    new ReadFCm(), new AndCm(), new OrCm(), new XorCm(), new NotCm(), new LoadRCm(), new LoadRVCm(),
+    new CallCm(), new LoadF(), new SetF(), new EndpCm() };
+
 Processor::Processor()
 {
     for (size_t i = 0; i < ADDRESS_REGS; i++)
@@ -7,18 +17,54 @@ Processor::Processor()
 
     flags = 0;
     sp = START_STACK;
+    memory.watch(&decoded);
+    reader.tie(&printer);
 }
 
-// Resetting values ​​in memory and registers
+// Resetting values ​​in memory, registers and flags
 void Processor::reset() noexcept
 {
     memory.clear();
+    decoded.clear();
+    jit.flush();
     for (size_t i = 0; i < ADDRESS_REGS; i++)
         address_regs[i] = 0;
+    flags = 0;
+    deferred = DeferredFlags();
+    sp = START_STACK;
+    ip = 0;
+    fused_executed = 0;
+    dead_flag_updates = 0;
+    flag_updates_skipped = 0;
 }
 
 // Starting the processor
 void Processor::run(uint16_t start_address)
+{
+    printer.set_sink(output);
+    reader.set_stream(input);
+    // Profiled and traced runs always call the Command objects
+    if (profiler || tracer) run_instrumented(start_address);
+    else if (dispatch == Dispatch::Threaded) run_threaded(start_address);
+    else if (dispatch == Dispatch::Jit) run_jit(start_address);
+    else run_virtual(start_address);
+    printer.finish();
+}
+
+// Choosing the instruction dispatch method
+void Processor::set_dispatch(Dispatch mode) noexcept
+{
+    dispatch = mode;
+}
+
+// Executing a command that is not a transition by its Command object
+void Processor::exec_command(Word word) noexcept
+{
+    (*commands[word.cmd3ops.cmd])(word, *this);
+}
+
+// Run loop calling the Command objects
+void Processor::run_virtual(uint16_t start_address)
 {
     ip = start_address;
     Word word = memory.get_word(ip);
@@ -33,17 +79,107 @@ void Processor::run(uint16_t start_address)
     }
 }
 
-// Setting a Flag Value
-void Processor::set_flag(uint8_t flag_index, bool is_true) noexcept
+// Run loop calling the Command objects, which counts the executed instructions
+// and records them into the trace. It is separate from the other run loops,
+// so they have no profiling or tracing code
+void Processor::run_instrumented(uint16_t start_address)
 {
-    if (is_true) flags |= (1 << flag_index);
-    else flags &= ~(1 << flag_index);
+    ip = start_address;
+    Word word = memory.get_word(ip);
+    while (word.cmd3ops.cmd != 0)
+    {
+        uint8_t cmd = word.cmd3ops.cmd;
+        uint16_t address = ip;
+        TraceRecord rec = TraceRecord();
+        if (tracer)
+        {
+            rec.ip = address;
+            rec.word = word.uval;
+            for (int i = 0; i < 3; i++)
+                rec.operands[i] = address_regs[word.cmd3ops.regs[i]];
+        }
+        if (profiler) profiler->count(address, cmd);
+
+        (*commands[cmd])(word, *this);
+        if (cmd > OP_JLEF) ip += 2;
+
+        if (profiler)
+        {
+            // A jump to the next instruction is counted as not taken
+            if (cmd > OP_JMP && cmd <= OP_JLEF) profiler->branch(address, ip != uint16_t(address + 2));
+            else if (cmd == OP_CALL) profiler->call(ip);
+        }
+        if (tracer)
+        {
+            sync_flags();
+            rec.flags = flags;
+            tracer->record(rec);
+            if (tracer->reach(address)) tracer->dump();
+        }
+
+        word = memory.get_word(ip);
+    }
 }
-// Getting the value of a flag
-bool Processor::get_flag(uint8_t flag_index) const noexcept
+
+// Calculating the deferred flags (as Command::set_flags_int and the ArithCm overflow checks did)
+void Processor::calc_flags() noexcept
 {
-    int16_t mask = 1 << flag_index;
-    return (flags & mask) != 0;
+    Word res = deferred.result;
+    uint16_t value = 0;
+    if (deferred.is_float)
+    {
+        value |= (res.fval == 0) << 0; // Equal to zero flag
+        value |= (res.fval < 0) << 8; // Sign flag (1 if number is negative)
+    }
+    else
+    {
+        value |= (res.ival == 0) << 0;
+        value |= (res.ival < 0) << 8;
+    }
+    value |= ((deferred.parity.uval & 1) == 0) << 1; // Parity flag
+
+    if (deferred.mask & (1 << 9 | 1 << 10))
+    {
+        Word word1 = deferred.int1, word2 = deferred.int2, int_res = Word();
+        long long_res;
+        if (deferred.int_op == FlagsOp::AddInt)
+        {
+            int_res.uval = word1.uval + word2.uval;
+            long_res = (long)word1.ival + (long)word2.ival;
+        }
+        else if (deferred.int_op == FlagsOp::SubInt)
+        {
+            int_res.uval = word1.uval - word2.uval;
+            long_res = (long)word1.ival - (long)word2.ival;
+        }
+        else
+        {
+            int_res.uval = word1.uval * word2.uval;
+            long_res = (long)word1.ival * (long)word2.ival;
+        }
+        value |= (long_res != int_res.ival) << 9; // Signed integer overflow flag
+        value |= (long_res != int_res.uval) << 10; // Carry flag (unsigned integer overflow)
+    }
+
+    if (deferred.mask & (1 << 11))
+    {
+        Word word1 = deferred.float1, word2 = deferred.float2, float_res = Word();
+        double double_res;
+        if (deferred.float_op == FlagsOp::AddFloat)
+        {
+            float_res.fval = word1.fval + word2.fval;
+            double_res = (double)word1.fval + (double)word2.fval;
+        }
+        else
+        {
+            float_res.fval = word1.fval * word2.fval;
+            double_res = (double)word1.fval * (double)word2.fval;
+        }
+        value |= (double_res != float_res.fval) << 11; // Fractional overflow flag
+    }
+
+    flags = (flags & ~deferred.mask) | (value & deferred.mask);
+    deferred.mask = 0;
 }
 
 // Getting the Instruction Pointer
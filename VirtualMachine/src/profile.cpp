@@ -0,0 +1,101 @@
+#include "profile.h"
+#include <vector>
+#include <algorithm>
+#include <iomanip>
+
+namespace
+{
+    // Names of the operation codes (same order as in the assembler)
+    const char* const MNEMONICS[OP_AMOUNT] = {
+        "end", "jmp", "je", "jeu", "jef", "jg", "jgu", "jgf", "jl", "jlu", "jlf",
+        "jne", "jneu", "jnef", "jge", "jgeu", "jgef", "jle", "jleu", "jlef",
+        "print", "printu", "printf", "load", "neg", "negf", "cmp", "cmpu", "cmpf",
+        "add", "addf", "sub", "subf", "mul", "mulf", "divu", "div", "divf", "modu", "mod",
+        "inc", "dec", "read", "readu", "readf", "and", "or", "xor", "not",
+        "loadr", "loadrv", "call", "loadf", "setf", "endp" };
+
+    // Indexes of the non-zero counters, from the largest counter
+    std::vector<uint32_t> sorted(const unsigned long long* counters, uint32_t size)
+    {
+        std::vector<uint32_t> result;
+        for (uint32_t i = 0; i < size; i++)
+            if (counters[i] != 0) result.push_back(i);
+        std::stable_sort(result.begin(), result.end(),
+            [counters](uint32_t a, uint32_t b) { return counters[a] > counters[b]; });
+        return result;
+    }
+
+    double percent(unsigned long long part, unsigned long long total)
+    {
+        return total == 0 ? 0.0 : 100.0 * part / total;
+    }
+}
+
+Profiler::Profiler()
+{
+    addresses = new unsigned long long[SIZE];
+    taken = new unsigned long long[SIZE];
+    not_taken = new unsigned long long[SIZE];
+    calls = new unsigned long long[SIZE];
+    clear();
+}
+
+Profiler::~Profiler()
+{
+    delete[] addresses;
+    delete[] taken;
+    delete[] not_taken;
+    delete[] calls;
+}
+
+// Resetting all counters
+void Profiler::clear() noexcept
+{
+    std::fill(opcodes, opcodes + CODES, 0ULL);
+    std::fill(addresses, addresses + SIZE, 0ULL);
+    std::fill(taken, taken + SIZE, 0ULL);
+    std::fill(not_taken, not_taken + SIZE, 0ULL);
+    std::fill(calls, calls + SIZE, 0ULL);
+}
+
+// Name of an operation code in the assembler
+const char* Profiler::mnemonic(uint8_t cmd) noexcept
+{
+    return cmd < OP_AMOUNT ? MNEMONICS[cmd] : "?";
+}
+
+// Writing the counters sorted from the largest
+void Profiler::report(std::ostream& out) const
+{
+    unsigned long long total = 0;
+    for (uint32_t i = 0; i < CODES; i++)
+        total += opcodes[i];
+
+    std::ios_base::fmtflags format = out.flags();
+    out << std::fixed << std::setprecision(2);
+    out << "Instructions executed: " << total << "\n\n";
+
+    out << "Operation codes:\n";
+    for (uint32_t cmd : sorted(opcodes, CODES))
+        out << std::setw(8) << mnemonic(uint8_t(cmd)) << std::setw(16) << opcodes[cmd]
+            << std::setw(8) << percent(opcodes[cmd], total) << "%\n";
+
+    out << "\nInstruction addresses:\n";
+    for (uint32_t address : sorted(addresses, SIZE))
+        out << std::setw(8) << address << std::setw(16) << addresses[address]
+            << std::setw(8) << percent(addresses[address], total) << "%\n";
+
+    // Conditional jumps are sorted by the number of executions
+    std::vector<unsigned long long> jumps(SIZE);
+    for (uint32_t i = 0; i < SIZE; i++)
+        jumps[i] = taken[i] + not_taken[i];
+    out << "\nConditional jumps (address, taken, not taken):\n";
+    for (uint32_t address : sorted(jumps.data(), SIZE))
+        out << std::setw(8) << address << std::setw(16) << taken[address]
+            << std::setw(16) << not_taken[address] << '\n';
+
+    out << "\nCalled subroutines (address, calls):\n";
+    for (uint32_t address : sorted(calls, SIZE))
+        out << std::setw(8) << address << std::setw(16) << calls[address] << '\n';
+    out.flags(format);
+}
@@ -0,0 +1,111 @@
+#include "trace.h"
+#include <csignal>
+#include <cstring>
+
+#if defined(__unix__)
+#include <fcntl.h>
+#include <unistd.h>
+#define VM_TRACE_POSIX
+#else
+#include <cstdio>
+#endif
+
+namespace
+{
+    // Tracer dumped by the signal handler
+    std::atomic<Tracer*> signal_tracer(nullptr);
+
+    void dump_signal_tracer(int)
+    {
+        Tracer* tracer = signal_tracer.load();
+        if (tracer) tracer->dump();
+    }
+
+#ifdef VM_TRACE_POSIX
+    using File = int;
+    File open_file(const char* path) noexcept { return open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644); }
+    bool is_open(File file) noexcept { return file >= 0; }
+    void close_file(File file) noexcept { close(file); }
+
+    // Writing the whole buffer (write can stop after a part of it)
+    bool write_all(File file, const void* data, size_t size) noexcept
+    {
+        const char* bytes = static_cast<const char*>(data);
+        while (size > 0)
+        {
+            ssize_t count = write(file, bytes, size);
+            if (count <= 0) return false;
+            bytes += count;
+            size -= size_t(count);
+        }
+        return true;
+    }
+#else
+    // Without POSIX the trace is written by stdio, which cannot be used by signal handlers
+    using File = std::FILE*;
+    File open_file(const char* path) noexcept { return std::fopen(path, "wb"); }
+    bool is_open(File file) noexcept { return file != nullptr; }
+    void close_file(File file) noexcept { std::fclose(file); }
+    bool write_all(File file, const void* data, size_t size) noexcept
+    {
+        return std::fwrite(data, 1, size, file) == size;
+    }
+#endif
+}
+
+Tracer::Tracer(const std::string& path, uint32_t capacity) : path(path)
+{
+    uint64_t size = 2;
+    while (size < capacity) size <<= 1;
+    records = new TraceRecord[size]();
+    mask = size - 1;
+}
+
+Tracer::~Tracer()
+{
+    if (signal_tracer.load() == this) dump_on_signal(nullptr);
+    delete[] records;
+}
+
+// Dumping the trace when the instruction at the address is reached for the first time
+void Tracer::set_trigger(uint16_t address) noexcept
+{
+    trigger = address;
+    has_trigger = true;
+}
+
+// Writing the kept records into the file, from the oldest one.
+// The signal can interrupt the writing of a record, so the slot after the newest
+// record is not written when the buffer is full: it may hold a part of the next one
+bool Tracer::dump() const noexcept
+{
+    uint64_t executed = written.load(std::memory_order_acquire);
+    uint64_t count = executed < mask ? executed : mask;
+    uint64_t first = (executed - count) & mask;
+
+    TraceHeader header;
+    std::memcpy(header.magic, "VM9T", 4);
+    header.version = VERSION;
+    header.record_size = sizeof(TraceRecord);
+    header.records = count;
+    header.executed = executed;
+
+    File file = open_file(path.c_str());
+    if (!is_open(file)) return false;
+    // The records can go around the end of the buffer
+    uint64_t tail = first + count <= mask + 1 ? count : mask + 1 - first;
+    bool ok = write_all(file, &header, sizeof(header))
+        && write_all(file, records + first, size_t(tail) * sizeof(TraceRecord))
+        && write_all(file, records, size_t(count - tail) * sizeof(TraceRecord));
+    close_file(file);
+    return ok;
+}
+
+// Dumping the trace of this tracer when the process gets SIGUSR1
+void Tracer::dump_on_signal(Tracer* tracer) noexcept
+{
+    signal_tracer.store(tracer);
+#ifdef SIGUSR1
+    std::signal(SIGUSR1, tracer ? dump_signal_tracer : SIG_DFL);
+#endif
+}
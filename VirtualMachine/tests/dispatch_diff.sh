@@ -0,0 +1,46 @@
+#!/bin/sh
+# Runs every code file of the programs directory under all dispatch modes and compares
+# the output with the one of --dispatch=virtual, which calls the Command objects.
+# The input of a program, if it reads any, is in the file NAME.in, and a program can be
+# run with several inputs NAME.1.in, NAME.2.in... Every input is also read with --input,
+# which must give the same values as the reading from the console
+# Usage: dispatch_diff.sh path_to_VirtualMachine9
+vm=${1:?"Usage: $0 path_to_VirtualMachine9"}
+dir=$(dirname "$0")/programs
+failed=0
+
+run() # program input options...
+{
+    code=$1; input_file=$2; shift 2
+    "$vm" "$@" "$code" < "$input_file"
+}
+
+check() # program input expected options...
+{
+    # The options are split into words on purpose
+    actual=$(run "$1" "$2" $4)
+    if [ "$actual" != "$3" ]; then
+        echo "FAILED: $(basename "$1") with $4 (input $(basename "$2"))"
+        failed=1
+    fi
+}
+
+check_modes() # program input
+{
+    expected=$(run "$1" "$2" --dispatch=virtual)
+    for mode in "--dispatch=threaded" "--dispatch=threaded --no-flag-analysis" "--dispatch=threaded --no-fusion" \
+        "--jit --jit-threshold=1"; do
+        check "$1" "$2" "$expected" "$mode"
+    done
+    [ "$2" = /dev/null ] || check "$1" "$2" "$expected" "--input=$2"
+}
+
+for program in "$dir"/*.txt; do
+    name=${program%.txt}
+    [ -f "$name".in ] || check_modes "$program" /dev/null
+    for input in "$name".in "$name".*.in; do
+        [ -f "$input" ] && check_modes "$program" "$input"
+    done
+done
+[ $failed -eq 0 ] && echo "All dispatch modes give the same output."
+exit $failed